@@ -0,0 +1,462 @@
+// ipc_bench.cpp
+// Round-trip latency and streaming throughput of the Lab3 IPC mechanisms.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "shm_channels.h"
+
+#define RING_CAPACITY (1u << 20)
+#define MIN_MSG_SIZE 16
+#define MAX_MSG_SIZE (1u << 20)
+
+static bool use_msync = false;
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void die(const char* what) {
+    perror(what);
+    exit(1);
+}
+
+// Log-linear histogram in the spirit of HdrHistogram: every power of two is
+// split into 2^SUB_BITS buckets, so any recorded value is off by less than 1%.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 7;
+    static const uint64_t SUB_COUNT = 1ull << SUB_BITS;
+
+    LatencyHistogram() : counts_((64 - SUB_BITS + 1) * SUB_COUNT, 0) {}
+
+    void record(uint64_t value) {
+        counts_[index_of(value)]++;
+        total_++;
+        sum_ += value;
+        if (value > max_) max_ = value;
+    }
+
+    uint64_t percentile(double p) const {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total_ + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t v = highest_equivalent(i);
+                return v < max_ ? v : max_;
+            }
+        }
+        return max_;
+    }
+
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0.0; }
+
+private:
+    static size_t index_of(uint64_t v) {
+        if (v < SUB_COUNT) return v;
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((v >> shift) - SUB_COUNT);
+    }
+
+    static uint64_t highest_equivalent(size_t i) {
+        if (i < SUB_COUNT) return i;
+        int shift = static_cast<int>(i >> SUB_BITS) - 1;
+        uint64_t sub = (i & (SUB_COUNT - 1)) + SUB_COUNT;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// One direction of a link. Objects are created before fork() and used by
+// both processes afterwards, so all state has to live in shared mappings.
+class Channel {
+public:
+    virtual ~Channel() = default;
+    virtual void send(const char* buf, size_t len) = 0;
+    virtual void recv(char* buf, size_t len) = 0;
+};
+
+// The Lab3 protocol: SharedData in a mapped file guarded by named semaphores.
+// Lab3 uses a single semaphore plus polling on size; here a second one turns
+// it into a proper empty/full handoff so the benchmark measures the mechanism.
+class SemChannel : public Channel {
+public:
+    SemChannel() {
+        static int counter = 0;
+        std::string suffix = std::to_string(getpid()) + "_" + std::to_string(counter++);
+        path_ = "/tmp/ipc_bench_" + suffix;
+        std::string empty_name = "/ipc_bench_empty_" + suffix;
+        std::string full_name = "/ipc_bench_full_" + suffix;
+
+        int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd == -1) die("Error creating mapped file");
+        if (ftruncate(fd, sizeof(struct SharedData)) == -1) die("Error setting file size");
+        shared_ = (struct SharedData*)mmap(NULL, sizeof(struct SharedData),
+                                           PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (shared_ == MAP_FAILED) die("Error mapping file");
+
+        empty_ = sem_open(empty_name.c_str(), O_CREAT | O_EXCL, 0666, 1);
+        full_ = sem_open(full_name.c_str(), O_CREAT | O_EXCL, 0666, 0);
+        if (empty_ == SEM_FAILED || full_ == SEM_FAILED) die("Error creating semaphores");
+        sem_unlink(empty_name.c_str());
+        sem_unlink(full_name.c_str());
+        owner_ = getpid();
+    }
+
+    ~SemChannel() override {
+        munmap(shared_, sizeof(struct SharedData));
+        sem_close(empty_);
+        sem_close(full_);
+        if (getpid() == owner_) unlink(path_.c_str());
+    }
+
+    void send(const char* buf, size_t len) override {
+        do {
+            size_t chunk = len < SHARED_MEM_SIZE ? len : SHARED_MEM_SIZE;
+            sem_wait(empty_);
+            memcpy(shared_->data, buf, chunk);
+            shared_->size = chunk;
+            if (use_msync) msync(shared_, sizeof(struct SharedData), MS_SYNC);
+            sem_post(full_);
+            buf += chunk;
+            len -= chunk;
+        } while (len > 0);
+    }
+
+    void recv(char* buf, size_t len) override {
+        do {
+            sem_wait(full_);
+            size_t chunk = shared_->size;
+            memcpy(buf, shared_->data, chunk);
+            sem_post(empty_);
+            buf += chunk;
+            len -= chunk;
+        } while (len > 0);
+    }
+
+private:
+    std::string path_;
+    struct SharedData* shared_;
+    sem_t* empty_;
+    sem_t* full_;
+    pid_t owner_;
+};
+
+class FutexChannel : public Channel {
+public:
+    FutexChannel() {
+        slot_ = static_cast<FutexSlot*>(map_shared(sizeof(FutexSlot)));
+        if (!slot_) die("Error mapping futex slot");
+        slot_->init();
+    }
+    ~FutexChannel() override { munmap(slot_, sizeof(FutexSlot)); }
+
+    void send(const char* buf, size_t len) override { slot_->send(buf, len); }
+    void recv(char* buf, size_t len) override { slot_->recv(buf, len); }
+
+private:
+    FutexSlot* slot_;
+};
+
+class RingChannel : public Channel {
+public:
+    typedef SpscRing<RING_CAPACITY> Ring;
+
+    RingChannel() {
+        ring_ = static_cast<Ring*>(map_shared(sizeof(Ring)));
+        if (!ring_) die("Error mapping ring");
+        ring_->init();
+    }
+    ~RingChannel() override { munmap(ring_, sizeof(Ring)); }
+
+    void send(const char* buf, size_t len) override { ring_->send(buf, len); }
+    void recv(char* buf, size_t len) override { ring_->recv(buf, len); }
+
+private:
+    Ring* ring_;
+};
+
+class PipeChannel : public Channel {
+public:
+    PipeChannel() {
+        if (pipe(fds_) == -1) die("Error creating pipe");
+    }
+    ~PipeChannel() override {
+        close(fds_[0]);
+        close(fds_[1]);
+    }
+
+    void send(const char* buf, size_t len) override {
+        while (len > 0) {
+            ssize_t n = write(fds_[1], buf, len);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                die("Error writing to pipe");
+            }
+            buf += n;
+            len -= n;
+        }
+    }
+
+    void recv(char* buf, size_t len) override {
+        while (len > 0) {
+            ssize_t n = read(fds_[0], buf, len);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                die("Error reading from pipe");
+            }
+            if (n == 0) {
+                fprintf(stderr, "Unexpected end of pipe\n");
+                exit(1);
+            }
+            buf += n;
+            len -= n;
+        }
+    }
+
+private:
+    int fds_[2];
+};
+
+static const char* TRANSPORTS[] = {"sem", "futex", "ring", "pipe"};
+
+static std::unique_ptr<Channel> make_channel(const std::string& transport) {
+    if (transport == "sem") return std::make_unique<SemChannel>();
+    if (transport == "futex") return std::make_unique<FutexChannel>();
+    if (transport == "ring") return std::make_unique<RingChannel>();
+    if (transport == "pipe") return std::make_unique<PipeChannel>();
+    fprintf(stderr, "Unknown transport: %s\n", transport.c_str());
+    exit(1);
+}
+
+static void pin_to_cpu(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("Error pinning to cpu");
+    }
+}
+
+struct Options {
+    std::vector<std::string> transports;
+    bool latency = true;
+    bool throughput = true;
+    int producer_cpu = -1;
+    int consumer_cpu = -1;
+    size_t latency_iters = 100000;
+    size_t stream_bytes = 256u << 20;
+    const char* out = "ipc_bench.csv";
+};
+
+struct Result {
+    std::string transport;
+    std::string mode;
+    size_t msg_size;
+    size_t iterations;
+    LatencyHistogram hist;
+    double seconds = 0.0;
+};
+
+// Runs body in the parent and peer in a forked child, each on its own cpu.
+template <typename Parent, typename Peer>
+static void run_pair(const Options& opt, Parent body, Peer peer) {
+    pid_t child = fork();
+    if (child == -1) die("Error creating child");
+    if (child == 0) {
+        pin_to_cpu(opt.consumer_cpu);
+        peer();
+        _exit(0);
+    }
+    pin_to_cpu(opt.producer_cpu);
+    body();
+    int status;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Benchmark peer failed\n");
+        exit(1);
+    }
+}
+
+static Result measure_latency(const Options& opt, const std::string& transport, size_t size) {
+    std::unique_ptr<Channel> ping = make_channel(transport);
+    std::unique_ptr<Channel> pong = make_channel(transport);
+    std::vector<char> buf(size, 'x');
+    // Large messages get fewer round trips so every size moves a similar volume.
+    size_t iters = opt.stream_bytes / size;
+    if (iters > opt.latency_iters) iters = opt.latency_iters;
+    if (iters < 100) iters = 100;
+    size_t warmup = iters / 100;
+    size_t total = warmup + iters;
+
+    Result result{transport, "latency", size, iters, {}};
+    run_pair(opt,
+        [&] {
+            for (size_t i = 0; i < total; i++) {
+                uint64_t start = now_ns();
+                ping->send(buf.data(), size);
+                pong->recv(buf.data(), size);
+                if (i >= warmup) result.hist.record(now_ns() - start);
+            }
+        },
+        [&] {
+            for (size_t i = 0; i < total; i++) {
+                ping->recv(buf.data(), size);
+                pong->send(buf.data(), size);
+            }
+        });
+    return result;
+}
+
+static Result measure_throughput(const Options& opt, const std::string& transport, size_t size) {
+    std::unique_ptr<Channel> data = make_channel(transport);
+    std::unique_ptr<Channel> ack = make_channel(transport);
+    std::vector<char> buf(size, 'x');
+    char token = 0;
+    size_t count = opt.stream_bytes / size;
+    if (count < 16) count = 16;
+
+    Result result{transport, "throughput", size, count, {}};
+    run_pair(opt,
+        [&] {
+            uint64_t start = now_ns();
+            for (size_t i = 0; i < count; i++) {
+                data->send(buf.data(), size);
+            }
+            ack->recv(&token, 1);
+            result.seconds = (now_ns() - start) / 1e9;
+        },
+        [&] {
+            for (size_t i = 0; i < count; i++) {
+                data->recv(buf.data(), size);
+            }
+            ack->send(&token, 1);
+        });
+    return result;
+}
+
+static void write_results(const Options& opt, const std::vector<Result>& results) {
+    FILE* out = fopen(opt.out, "w");
+    if (!out) die("Error opening output file");
+    fprintf(out, "transport,mode,msg_bytes,iterations,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,mean_ns,"
+                 "msgs_per_s,mb_per_s\n");
+    for (const Result& r : results) {
+        if (r.mode == "latency") {
+            fprintf(out, "%s,%s,%zu,%zu,%lu,%lu,%lu,%lu,%lu,%.1f,,\n",
+                    r.transport.c_str(), r.mode.c_str(), r.msg_size, r.iterations,
+                    r.hist.percentile(50), r.hist.percentile(90), r.hist.percentile(99),
+                    r.hist.percentile(99.9), r.hist.max(), r.hist.mean());
+        } else {
+            fprintf(out, "%s,%s,%zu,%zu,,,,,,,%.0f,%.2f\n",
+                    r.transport.c_str(), r.mode.c_str(), r.msg_size, r.iterations,
+                    r.iterations / r.seconds, r.iterations * r.msg_size / r.seconds / 1e6);
+        }
+    }
+    fclose(out);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --transport sem|futex|ring|pipe|all  (default all, may repeat)\n"
+            "  --mode latency|throughput|all        (default all)\n"
+            "  --cpus P,C       pin producer to cpu P and consumer to cpu C\n"
+            "  --iters N        ping-pong round trips per size (default 100000)\n"
+            "  --bytes N        bytes streamed per throughput run (default 256MiB)\n"
+            "  --spin N         futex spin iterations before sleeping\n"
+            "  --msync          msync the mapping after every write, like Lab3 does\n"
+            "  --out FILE       CSV output (default ipc_bench.csv)\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    bool spin_set = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--transport" && has_value) {
+            std::string t = argv[++i];
+            if (t == "all") {
+                opt.transports.assign(std::begin(TRANSPORTS), std::end(TRANSPORTS));
+            } else {
+                opt.transports.push_back(t);
+            }
+        } else if (arg == "--mode" && has_value) {
+            std::string m = argv[++i];
+            opt.latency = (m == "latency" || m == "all");
+            opt.throughput = (m == "throughput" || m == "all");
+            if (!opt.latency && !opt.throughput) usage(argv[0]);
+        } else if (arg == "--cpus" && has_value) {
+            if (sscanf(argv[++i], "%d,%d", &opt.producer_cpu, &opt.consumer_cpu) != 2) usage(argv[0]);
+        } else if (arg == "--iters" && has_value) {
+            opt.latency_iters = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--bytes" && has_value) {
+            opt.stream_bytes = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--spin" && has_value) {
+            spin_limit = atoi(argv[++i]);
+            spin_set = true;
+        } else if (arg == "--msync") {
+            use_msync = true;
+        } else if (arg == "--out" && has_value) {
+            opt.out = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.transports.empty()) {
+        opt.transports.assign(std::begin(TRANSPORTS), std::end(TRANSPORTS));
+    }
+
+    if (!spin_set && (sysconf(_SC_NPROCESSORS_ONLN) < 2 ||
+                      (opt.producer_cpu >= 0 && opt.producer_cpu == opt.consumer_cpu))) {
+        spin_limit = 0;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& transport : opt.transports) {
+        for (size_t size = MIN_MSG_SIZE; size <= MAX_MSG_SIZE; size *= 4) {
+            if (opt.latency) {
+                Result r = measure_latency(opt, transport, size);
+                printf("%-6s latency    %8zu B  p50 %8lu ns  p99 %8lu ns  p99.9 %8lu ns\n",
+                       transport.c_str(), size, r.hist.percentile(50),
+                       r.hist.percentile(99), r.hist.percentile(99.9));
+                results.push_back(std::move(r));
+            }
+            if (opt.throughput) {
+                Result r = measure_throughput(opt, transport, size);
+                printf("%-6s throughput %8zu B  %12.0f msg/s  %10.2f MB/s\n",
+                       transport.c_str(), size, r.iterations / r.seconds,
+                       r.iterations * size / r.seconds / 1e6);
+                results.push_back(std::move(r));
+            }
+            fflush(stdout);
+        }
+    }
+
+    write_results(opt, results);
+    printf("Results written to %s\n", opt.out);
+    return 0;
+}
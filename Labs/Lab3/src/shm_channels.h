@@ -0,0 +1,168 @@
+// shm_channels.h
+// Shared-memory transports built on futexes: a single-slot mailbox and an
+// SPSC byte ring. Both live in MAP_SHARED memory and work across fork().
+#ifndef SHM_CHANNELS_H
+#define SHM_CHANNELS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include "common.h"
+
+#define CACHE_LINE 64
+#define SPIN_LIMIT 2000
+
+// Spinning only pays off when the peer runs on another core; set to 0 on
+// uniprocessor machines or when both sides share a cpu.
+inline int spin_limit = SPIN_LIMIT;
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static inline void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+// Blocks while *word == value: spins first, then sleeps on the futex.
+// The waiters counter lets the other side skip the wake syscall when nobody sleeps.
+static inline void wait_while(std::atomic<uint32_t>* word, uint32_t value,
+                              std::atomic<uint32_t>* waiters) {
+    for (int i = 0; i < spin_limit; i++) {
+        if (word->load(std::memory_order_acquire) != value) return;
+        cpu_relax();
+    }
+    while (word->load(std::memory_order_acquire) == value) {
+        waiters->fetch_add(1, std::memory_order_seq_cst);
+        if (word->load(std::memory_order_seq_cst) == value) {
+            futex_wait(word, value);
+        }
+        waiters->fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+static inline void publish(std::atomic<uint32_t>* word, uint32_t value,
+                           std::atomic<uint32_t>* waiters) {
+    word->store(value, std::memory_order_seq_cst);
+    if (waiters->load(std::memory_order_seq_cst) > 0) {
+        futex_wake(word);
+    }
+}
+
+static inline void* map_shared(size_t size) {
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+// Single-slot mailbox: the same handoff as SharedData, but the full/empty
+// state is a futex word instead of a pair of named semaphores.
+struct FutexSlot {
+    alignas(CACHE_LINE) std::atomic<uint32_t> full;
+    alignas(CACHE_LINE) std::atomic<uint32_t> waiters;
+    alignas(CACHE_LINE) size_t size;
+    char data[SHARED_MEM_SIZE];
+
+    void init() {
+        full.store(0);
+        waiters.store(0);
+        size = 0;
+    }
+
+    void send(const char* buf, size_t len) {
+        do {
+            size_t chunk = len < SHARED_MEM_SIZE ? len : SHARED_MEM_SIZE;
+            wait_while(&full, 1, &waiters);
+            memcpy(data, buf, chunk);
+            size = chunk;
+            publish(&full, 1, &waiters);
+            buf += chunk;
+            len -= chunk;
+        } while (len > 0);
+    }
+
+    void recv(char* buf, size_t len) {
+        do {
+            wait_while(&full, 0, &waiters);
+            memcpy(buf, data, size);
+            buf += size;
+            len -= size;
+            publish(&full, 0, &waiters);
+        } while (len > 0);
+    }
+};
+
+// Single-producer single-consumer byte ring. head/tail are free-running
+// 32-bit positions, so they double as futex words; capacity must be a power
+// of two no larger than 2^31.
+template <size_t Capacity>
+struct SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0 && Capacity <= (1u << 31),
+                  "ring capacity must be a power of two");
+
+    alignas(CACHE_LINE) std::atomic<uint32_t> head;
+    std::atomic<uint32_t> head_waiters;
+    alignas(CACHE_LINE) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> tail_waiters;
+    alignas(CACHE_LINE) char data[Capacity];
+
+    void init() {
+        head.store(0);
+        tail.store(0);
+        head_waiters.store(0);
+        tail_waiters.store(0);
+    }
+
+    void send(const char* buf, size_t len) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        while (len > 0) {
+            uint32_t t = tail.load(std::memory_order_acquire);
+            if (h - t == Capacity) {
+                wait_while(&tail, t, &tail_waiters);
+                continue;
+            }
+            size_t offset = h & (Capacity - 1);
+            size_t n = Capacity - (h - t);
+            if (n > Capacity - offset) n = Capacity - offset;
+            if (n > len) n = len;
+            memcpy(data + offset, buf, n);
+            h += n;
+            publish(&head, h, &head_waiters);
+            buf += n;
+            len -= n;
+        }
+    }
+
+    void recv(char* buf, size_t len) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        while (len > 0) {
+            uint32_t h = head.load(std::memory_order_acquire);
+            if (h == t) {
+                wait_while(&head, h, &head_waiters);
+                continue;
+            }
+            size_t offset = t & (Capacity - 1);
+            size_t n = h - t;
+            if (n > Capacity - offset) n = Capacity - offset;
+            if (n > len) n = len;
+            memcpy(buf, data + offset, n);
+            t += n;
+            publish(&tail, t, &tail_waiters);
+            buf += n;
+            len -= n;
+        }
+    }
+};
+
+#endif
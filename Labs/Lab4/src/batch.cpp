@@ -0,0 +1,144 @@
+#include "batch.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "worker_pool.h"
+
+// Input is read in large chunks and split into blocks of lines; blocks run
+// on the pool and their output is written back in order.
+const size_t READ_CHUNK = 16 << 20;
+const size_t BLOCK_LINES = 4096;
+
+bool parse_batch_options(int argc, char* argv[], BatchOptions& options, std::vector<std::string>& rest) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--batch") {
+            options.enabled = true;
+            if (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) {
+                options.input = argv[++i];
+            }
+        } else if (arg == "--threads") {
+            if (i + 1 >= argc) return false;
+            options.threads = std::atoi(argv[++i]);
+        } else {
+            rest.push_back(arg);
+        }
+    }
+    return true;
+}
+
+static void run_line(const char* line, const char* end, IntFunc SinIntegral,
+                     TranslationToFunc TranslationTo, std::string& out) {
+    char buf[80];
+    char* next;
+    long code = std::strtol(line, &next, 10);
+    bool ok = next != line;
+    if (ok && code == 1) {
+        const char* p = next;
+        float A = std::strtof(p, &next);
+        ok = next != p;
+        p = next;
+        float B = std::strtof(p, &next);
+        ok = ok && next != p;
+        p = next;
+        float e = std::strtof(p, &next);
+        ok = ok && next != p && next <= end;
+        if (ok) {
+            int n = std::snprintf(buf, sizeof(buf), "%g\n", SinIntegral(A, B, e));
+            out.append(buf, n);
+            return;
+        }
+    } else if (ok && code == 2) {
+        const char* p = next;
+        long x = std::strtol(p, &next, 10);
+        ok = next != p && next <= end;
+        int n = ok ? TranslationTo(x, buf, sizeof(buf) - 1) : -1;
+        if (n >= 0) {
+            buf[n] = '\n';
+            out.append(buf, n + 1);
+            return;
+        }
+    }
+    out.append("error\n");
+}
+
+int run_batch(const BatchOptions& options, IntFunc SinIntegral, TranslationToFunc TranslationTo) {
+    FILE* in = options.input == "-" ? stdin : std::fopen(options.input.c_str(), "rb");
+    if (!in) {
+        std::perror("Error opening batch input");
+        return 1;
+    }
+
+    WorkerPool pool;
+    pool.set_threads(options.threads);
+
+    std::vector<char> data;
+    std::vector<size_t> lines;
+    std::vector<std::string> outputs;
+    long ops = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    size_t carry = 0;
+    bool eof = false;
+    while (!eof) {
+        data.resize(carry + READ_CHUNK + 1);
+        size_t got = std::fread(data.data() + carry, 1, READ_CHUNK, in);
+        eof = got < READ_CHUNK;
+        size_t size = carry + got;
+
+        // Only complete lines are processed; the tail waits for the next read
+        size_t usable = size;
+        if (!eof) {
+            while (usable > 0 && data[usable - 1] != '\n') usable--;
+            if (usable == 0) usable = size;
+        }
+        data[size] = '\0';
+
+        lines.clear();
+        for (size_t pos = 0; pos < usable;) {
+            const char* nl = static_cast<const char*>(std::memchr(data.data() + pos, '\n', usable - pos));
+            size_t end = nl ? nl - data.data() : usable;
+            bool blank = true;
+            for (size_t i = pos; i < end && blank; i++) blank = std::isspace(static_cast<unsigned char>(data[i]));
+            if (!blank) lines.push_back(pos);
+            pos = end + 1;
+        }
+        // Lines are parsed in place; turning newlines into terminators keeps
+        // strtol/strtof from running into the next line.
+        for (size_t i = 0; i < usable; i++) {
+            if (data[i] == '\n') data[i] = '\0';
+        }
+
+        long blocks = static_cast<long>((lines.size() + BLOCK_LINES - 1) / BLOCK_LINES);
+        outputs.assign(blocks, std::string());
+        pool.run(blocks, [&](long b) {
+            size_t first = b * BLOCK_LINES;
+            size_t last = std::min(lines.size(), first + BLOCK_LINES);
+            std::string& out = outputs[b];
+            out.reserve((last - first) * 24);
+            for (size_t i = first; i < last; i++) {
+                const char* line = data.data() + lines[i];
+                run_line(line, line + std::strlen(line), SinIntegral, TranslationTo, out);
+            }
+        });
+        for (const std::string& out : outputs) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+        }
+        ops += static_cast<long>(lines.size());
+
+        carry = size - usable;
+        if (carry > 0) std::memmove(data.data(), data.data() + usable, carry);
+    }
+    std::fflush(stdout);
+    if (in != stdin) std::fclose(in);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << "Processed " << ops << " operations in " << elapsed.count() << " s ("
+              << (elapsed.count() > 0 ? ops / elapsed.count() : 0.0) << " ops/s, "
+              << pool.threads() << " threads)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+typedef float (*IntFunc)(float, float, float);
+typedef int (*TranslationToFunc)(long, char*, int);
+
+// Non-interactive mode shared by program1 and program2. Input has one
+// operation per line, with the same codes as the menu:
+//   1 A B e   -> integral value
+//   2 x       -> translated number
+// Output has one result line per non-blank input line, in input order
+// ("error" for lines that do not parse). Throughput goes to stderr.
+
+struct BatchOptions {
+    bool enabled = false;
+    std::string input = "-";
+    int threads = 0;
+};
+
+// Picks --batch [FILE] and --threads N out of argv; other arguments are
+// returned in rest. Returns false on malformed options.
+bool parse_batch_options(int argc, char* argv[], BatchOptions& options, std::vector<std::string>& rest);
+
+int run_batch(const BatchOptions& options, IntFunc SinIntegral, TranslationToFunc TranslationTo);
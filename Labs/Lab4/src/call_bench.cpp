@@ -0,0 +1,116 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <dlfcn.h>
+#include "plugin_registry.h"
+#include "sin_simd.h"
+
+// program1-style linking against program2-style dispatch.
+// 1. Per-call overhead on an empty interval (A == B), so only the call
+//    itself is measured: a direct call inside the executable, a PLT call
+//    into lib_pr2_1.so, a dlsym() pointer and the PluginRegistry table.
+// 2. Error against wall time over a sweep of e for every plugin.
+// Results go to call_overhead.csv and accuracy.csv.
+
+extern "C" float SinIntegral(float A, float B, float e);
+
+__attribute__((noinline)) float DirectSinIntegral(float A, float B, float e) {
+    long steps = static_cast<long>((B - A) / e);
+
+    return static_cast<float>(rect_rule(A, e, steps));
+}
+
+const long CALLS = 20000000;
+const float A = 0.0f;
+const float B = 10.0f;
+
+template <typename Call>
+double ns_per_call(Call call) {
+    // volatile inputs keep the calls from being hoisted or folded
+    volatile float a = 1.0f;
+    volatile float e = 0.1f;
+    float sink = 0.0f;
+    double best = 1e30;
+    for (int round = 0; round < 3; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < CALLS; i++) {
+            sink += call(a, a, e);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / CALLS);
+    }
+    if (sink != 0.0f) std::cerr << "unexpected result\n";
+    return best;
+}
+
+double seconds_per_call(IntFunc f, float e, float& value) {
+    double best = 1e30;
+    long calls = 1;
+    for (int round = 0; round < 3; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < calls; i++) {
+            value = f(A, B, e);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / calls);
+        // Repeat cheap calls so the clock resolution does not dominate
+        if (elapsed.count() < 1e-3) calls *= 100;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* plugin_dir = argc > 1 ? argv[1] : ".";
+
+    void* lib = dlopen("./lib_pr2_1.so", RTLD_NOW);
+    if (!lib)
+    {
+        std::cerr << "Error loading library: " << dlerror() << std::endl;
+        return 1;
+    }
+    IntFunc dl_SinIntegral = (IntFunc)dlsym(lib, "SinIntegral");
+
+    PluginRegistry registry;
+    if (!dl_SinIntegral || registry.load(plugin_dir) == 0)
+    {
+        std::cerr << "Failed to load symbols or plugins" << std::endl;
+        return 1;
+    }
+
+    std::ofstream overhead("call_overhead.csv");
+    overhead << "kind,ns_per_call\n";
+    struct {
+        const char* kind;
+        double ns;
+    } calls[] = {
+        {"direct", ns_per_call([](float a, float b, float e) { return DirectSinIntegral(a, b, e); })},
+        {"plt", ns_per_call([](float a, float b, float e) { return SinIntegral(a, b, e); })},
+        {"dlsym", ns_per_call([&](float a, float b, float e) { return dl_SinIntegral(a, b, e); })},
+        {"registry", ns_per_call([&](float a, float b, float e) { return registry.active().SinIntegral(a, b, e); })},
+    };
+    for (auto& call : calls)
+    {
+        std::cout << call.kind << ": " << call.ns << " ns per call\n";
+        overhead << call.kind << "," << call.ns << "\n";
+    }
+
+    std::ofstream accuracy("accuracy.csv");
+    accuracy << "library,method,e,error,seconds\n";
+    const double exact = std::cos(A) - std::cos(B);
+    for (size_t i = 0; i < registry.size(); i++)
+    {
+        const PluginTable& plugin = registry.at(i);
+        for (float e = 0.1f; e >= 1e-7f; e /= std::sqrt(10.0f))
+        {
+            float value = 0.0f;
+            double seconds = seconds_per_call(plugin.SinIntegral, e, value);
+            accuracy << plugin.path << "," << plugin.method << "," << e << ","
+                     << std::fabs(value - exact) << "," << seconds << "\n";
+        }
+    }
+    std::cout << "Results written to call_overhead.csv and accuracy.csv\n";
+    dlclose(lib);
+    return 0;
+}
@@ -1,14 +1,30 @@
-#include <cmath>
+#include "sin_dispatch.h"
+#include "plugin.h"
+#include "prefix_cache.h"
 
-extern "C" float SinIntegral(float A, float B, float e) {
-    float result = 0.0f;
+LAB4_INTEGRAL_PLUGIN("rectangles");
 
-    int steps = static_cast<int>((B - A) / e);
+struct Rectangles {
+    SIMD_INLINE float integral(float A, float B, float e) {
+        long steps = static_cast<long>((B - A) / e);
 
-    for (int i = 0; i < steps; i++) {
-        float x = A + i * e + e / 2.0f;
-        result += sin(x) * e;
+        return static_cast<float>(rect_rule(A, e, steps));
     }
+};
 
-    return result;
+extern "C" {
+
+static IntFunc resolve_SinIntegral() {
+    return select_sin_integral<Rectangles>();
+}
+
+float SinIntegral(float A, float B, float e) __attribute__((ifunc("resolve_SinIntegral")));
+
+// Instruction set SinIntegral was resolved to
+const char* SinIntegralIsa() {
+    return sin_isa_name();
 }
+
+}
+
+LAB4_CACHE_EXPORTS(RectPanels);
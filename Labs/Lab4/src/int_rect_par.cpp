@@ -0,0 +1,12 @@
+#include "sin_parallel.h"
+#include "plugin.h"
+
+LAB4_INTEGRAL_PLUGIN("rectangles (parallel)");
+
+extern "C" float SinIntegral(float A, float B, float e) {
+    long steps = static_cast<long>((B - A) / e);
+
+    return static_cast<float>(parallel_sin_sum(A + e / 2.0, e, 0, steps) * e);
+}
+
+LAB4_THREAD_EXPORTS();
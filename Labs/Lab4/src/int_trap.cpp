@@ -1,16 +1,30 @@
-#include <cmath>
+#include "sin_dispatch.h"
+#include "plugin.h"
+#include "prefix_cache.h"
 
-extern "C" float SinIntegral(float A, float B, float e) {
-    int n = (int)((B - A) / e);
-    float result = sin(A) / 2.0f;
+LAB4_INTEGRAL_PLUGIN("trapeze");
 
-    for(int i = 1; i < n; i++) {
-        float x = A + i * e;
-        result += sin(x);
+struct Trapezoids {
+    SIMD_INLINE float integral(float A, float B, float e) {
+        long n = static_cast<long>((B - A) / e);
+
+        return static_cast<float>(trap_rule(A, B, e, n));
     }
+};
+
+extern "C" {
+
+static IntFunc resolve_SinIntegral() {
+    return select_sin_integral<Trapezoids>();
+}
 
-    result += sin(B) / 2.0f;
-    result *= e;
+float SinIntegral(float A, float B, float e) __attribute__((ifunc("resolve_SinIntegral")));
 
-    return result;
+// Instruction set SinIntegral was resolved to
+const char* SinIntegralIsa() {
+    return sin_isa_name();
 }
+
+}
+
+LAB4_CACHE_EXPORTS(TrapPanels);
@@ -0,0 +1,13 @@
+#include "sin_parallel.h"
+#include "plugin.h"
+
+LAB4_INTEGRAL_PLUGIN("trapeze (parallel)");
+
+extern "C" float SinIntegral(float A, float B, float e) {
+    long n = static_cast<long>((B - A) / e);
+    double inner = parallel_sin_sum(A, e, 1, n - 1);
+
+    return static_cast<float>((std::sin(A) / 2.0 + inner + std::sin(B) / 2.0) * e);
+}
+
+LAB4_THREAD_EXPORTS();
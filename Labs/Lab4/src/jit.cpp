@@ -0,0 +1,283 @@
+#include "jit.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Bump when the generated code changes so stale libraries are not reused
+#define JIT_GENERATOR_VERSION 1
+#define JIT_MAX_EXPRESSION 1024
+#define JIT_DEFAULT_FLAGS "-O3 -march=native -ffast-math -fPIC -shared"
+
+static const char* const JIT_FUNCTIONS[] = {
+    "sin", "cos", "tan", "asin", "acos", "atan", "atan2", "sinh", "cosh", "tanh",
+    "exp", "log", "log10", "sqrt", "cbrt", "abs", "fabs", "pow", "floor", "ceil",
+};
+
+bool parse_jit_rule(const std::string& name, JitRule& rule) {
+    if (name == "rectangles") rule = JitRule::Rectangles;
+    else if (name == "trapeze") rule = JitRule::Trapezoids;
+    else if (name == "simpson") rule = JitRule::Simpson;
+    else return false;
+    return true;
+}
+
+const char* jit_rule_name(JitRule rule) {
+    switch (rule) {
+    case JitRule::Rectangles: return "rectangles";
+    case JitRule::Trapezoids: return "trapeze";
+    case JitRule::Simpson: return "simpson";
+    }
+    return "?";
+}
+
+static bool known_identifier(const std::string& name) {
+    if (name == "x" || name == "pi") return true;
+    for (const char* fn : JIT_FUNCTIONS) {
+        if (name == fn) return true;
+    }
+    return false;
+}
+
+// Keeps adjacent words apart, so "2 x" fails to compile instead of
+// silently becoming something else
+static void separate(std::string& out) {
+    if (!out.empty() && (std::isalnum(static_cast<unsigned char>(out.back())) || out.back() == '.')) {
+        out += ' ';
+    }
+}
+
+// Tokenizes expr and rebuilds it in a canonical spacing. Only whitelisted
+// identifiers, numbers, operators and balanced parentheses get through, so
+// the result can be pasted into generated code as is.
+static bool normalize_expression(const std::string& expr, std::string& out, std::string& error) {
+    if (expr.size() > JIT_MAX_EXPRESSION) {
+        error = "expression is too long";
+        return false;
+    }
+    int depth = 0;
+    size_t i = 0;
+    while (i < expr.size()) {
+        char c = expr[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = i;
+            while (i < expr.size() && (std::isalnum(static_cast<unsigned char>(expr[i])) || expr[i] == '_')) i++;
+            std::string name = expr.substr(start, i - start);
+            if (!known_identifier(name)) {
+                error = "unknown identifier '" + name + "'";
+                return false;
+            }
+            separate(out);
+            out += name;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            size_t start = i;
+            while (i < expr.size() && (std::isdigit(static_cast<unsigned char>(expr[i])) || expr[i] == '.')) i++;
+            if (i < expr.size() && (expr[i] == 'e' || expr[i] == 'E')) {
+                size_t j = i + 1;
+                if (j < expr.size() && (expr[j] == '+' || expr[j] == '-')) j++;
+                if (j < expr.size() && std::isdigit(static_cast<unsigned char>(expr[j]))) {
+                    i = j;
+                    while (i < expr.size() && std::isdigit(static_cast<unsigned char>(expr[i]))) i++;
+                }
+            }
+            // Doubles only, so 1/2 is not integer division
+            std::string number = expr.substr(start, i - start);
+            separate(out);
+            out += number;
+            if (number.find_first_of(".eE") == std::string::npos) out += ".0";
+        } else if (std::strchr("+-*/,", c)) {
+            out += c;
+            i++;
+        } else if (c == '(' || c == ')') {
+            depth += c == '(' ? 1 : -1;
+            if (depth < 0) {
+                error = "unbalanced ')'";
+                return false;
+            }
+            out += c;
+            i++;
+        } else {
+            error = std::string("unexpected character '") + c + "'";
+            return false;
+        }
+    }
+    if (depth != 0) {
+        error = "unbalanced '('";
+        return false;
+    }
+    if (out.empty()) {
+        error = "empty expression";
+        return false;
+    }
+    return true;
+}
+
+// Same grids as the Lab4 libraries: midpoints of floor((B - A) / e) panels,
+// trapezoids closing the last panel at B, and Simpson over an even count.
+// Every sample is computed from its index, so the loops vectorize.
+static std::string generate_source(const std::string& expr, JitRule rule) {
+    std::ostringstream src;
+    src << "#include <cmath>\n"
+        << "using namespace std;\n"
+        << "static const double pi = 3.14159265358979323846;\n"
+        << "static inline double f(double x) { return " << expr << "; }\n"
+        << "extern \"C\" const char ExprJitSource[] = \"" << jit_rule_name(rule) << ":" << expr << "\";\n"
+        << "extern \"C\" double ExprIntegral(double A, double B, double e) {\n"
+        << "    long n = static_cast<long>((B - A) / e);\n"
+        << "    double sum = 0.0;\n";
+    switch (rule) {
+    case JitRule::Rectangles:
+        src << "    for (long i = 0; i < n; i++) sum += f(A + (i + 0.5) * e);\n"
+            << "    return sum * e;\n";
+        break;
+    case JitRule::Trapezoids:
+        src << "    for (long i = 1; i < n; i++) sum += f(A + i * e);\n"
+            << "    return (f(A) / 2.0 + sum + f(B) / 2.0) * e;\n";
+        break;
+    case JitRule::Simpson:
+        src << "    long half = n / 2;\n"
+            << "    if (half <= 0) return 0.0;\n"
+            << "    double odd = 0.0;\n"
+            << "    for (long k = 0; k < half; k++) odd += f(A + (2 * k + 1) * e);\n"
+            << "    for (long k = 1; k < half; k++) sum += f(A + 2 * k * e);\n"
+            << "    return (f(A) + 4.0 * odd + 2.0 * sum + f(A + 2 * half * e)) * e / 3.0;\n";
+        break;
+    }
+    src << "}\n";
+    return src.str();
+}
+
+static unsigned long fnv1a(const std::string& s) {
+    unsigned long h = 14695981039346656037UL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// Runs the compiler without a shell; flags are split on whitespace
+static bool run_compiler(const std::string& compiler, const std::string& flags,
+                         const std::string& source, const std::string& output) {
+    std::vector<std::string> args{compiler};
+    std::istringstream split(flags);
+    for (std::string flag; split >> flag;) args.push_back(flag);
+    args.insert(args.end(), {"-o", output, source});
+
+    std::vector<char*> argv;
+    for (std::string& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv.data());
+        perror(argv[0]);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+ExprJit::ExprJit() {
+    const char* dir = std::getenv("LAB4_JIT_CACHE");
+    const char* cxx = std::getenv("CXX");
+    const char* flags = std::getenv("LAB4_JIT_FLAGS");
+    cache_dir_ = dir && *dir ? dir : "./jit_cache";
+    compiler_ = cxx && *cxx ? cxx : "c++";
+    flags_ = flags && *flags ? flags : JIT_DEFAULT_FLAGS;
+}
+
+ExprJit::~ExprJit() {
+    for (void* handle : handles_) {
+        dlclose(handle);
+    }
+}
+
+ExprIntegralFunc ExprJit::compile(const std::string& expr, JitRule rule, bool* cached) {
+    std::string normalized, error;
+    if (!normalize_expression(expr, normalized, error)) {
+        std::cerr << "Error in expression: " << error << std::endl;
+        return nullptr;
+    }
+    std::string tag = std::string(jit_rule_name(rule)) + ":" + normalized;
+    if (cached) *cached = true;
+
+    auto it = loaded_.find(tag);
+    if (it != loaded_.end()) {
+        return it->second;
+    }
+
+    // The compiler and flags are part of the key, so changing them rebuilds
+    std::ostringstream key;
+    key << JIT_GENERATOR_VERSION << "\n" << compiler_ << "\n" << flags_ << "\n" << tag;
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016lx", fnv1a(key.str()));
+    std::string base = cache_dir_ + "/jit_" + hash;
+    std::string library = base + ".so";
+
+    if (!file_exists(library)) {
+        if (cached) *cached = false;
+        mkdir(cache_dir_.c_str(), 0755);
+        std::string source = base + ".cpp";
+        {
+            std::ofstream out(source);
+            out << generate_source(normalized, rule);
+            if (!out) {
+                std::cerr << "Error writing " << source << std::endl;
+                return nullptr;
+            }
+        }
+        // Build under a private name and rename, so a concurrent run never
+        // dlopens a half-written library
+        std::string partial = base + ".tmp." + std::to_string(getpid()) + ".so";
+        if (!run_compiler(compiler_, flags_, source, partial)) {
+            std::cerr << "Error compiling " << source << std::endl;
+            unlink(partial.c_str());
+            return nullptr;
+        }
+        if (rename(partial.c_str(), library.c_str()) != 0) {
+            perror("rename");
+            unlink(partial.c_str());
+            return nullptr;
+        }
+    }
+
+    void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        std::cerr << "Error loading library: " << dlerror() << std::endl;
+        return nullptr;
+    }
+    auto* source = (const char*)dlsym(handle, "ExprJitSource");
+    auto integral = (ExprIntegralFunc)dlsym(handle, "ExprIntegral");
+    if (!source || !integral || tag != source) {
+        std::cerr << "Skipping " << library << ": does not match the expression" << std::endl;
+        dlclose(handle);
+        return nullptr;
+    }
+    handles_.push_back(handle);
+    loaded_[tag] = integral;
+    return integral;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef double (*ExprIntegralFunc)(double A, double B, double e);
+
+enum class JitRule { Rectangles, Trapezoids, Simpson };
+
+// "rectangles", "trapeze" or "simpson"
+bool parse_jit_rule(const std::string& name, JitRule& rule);
+const char* jit_rule_name(JitRule rule);
+
+// Integrals of user expressions in x, compiled to native code. Each
+// (expression, rule) pair becomes a small C++ file with the integrand
+// inlined into the quadrature loop, built once with $CXX into
+// $LAB4_JIT_CACHE (default ./jit_cache) as jit_<hash>.so and dlopened;
+// later runs reuse the cached library without invoking the compiler.
+//
+// Expressions may use numbers, x, pi, + - * / ( ) , and the functions
+// sin cos tan asin acos atan atan2 sinh cosh tanh exp log log10 sqrt cbrt
+// abs fabs pow floor ceil. Anything else is rejected before compiling.
+class ExprJit {
+public:
+    ExprJit();
+    ~ExprJit();
+
+    ExprJit(const ExprJit&) = delete;
+    ExprJit& operator=(const ExprJit&) = delete;
+
+    // Returns nullptr and reports to stderr if the expression is rejected
+    // or does not compile. cached is set when no compiler run was needed.
+    ExprIntegralFunc compile(const std::string& expr, JitRule rule, bool* cached = nullptr);
+
+private:
+    std::string cache_dir_;
+    std::string compiler_;
+    std::string flags_;
+    std::unordered_map<std::string, ExprIntegralFunc> loaded_;
+    std::vector<void*> handles_;
+};
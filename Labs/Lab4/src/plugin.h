@@ -0,0 +1,20 @@
+#pragma once
+
+// Every Lab4 library describes its two halves with these exported objects:
+//   IntegralPlugin    - defined next to SinIntegral
+//   TranslationPlugin - defined next to Translation
+// program2 only loads libraries whose descriptors carry the current ABI.
+// Bump LAB4_PLUGIN_ABI whenever an exported signature changes.
+
+#define LAB4_PLUGIN_ABI 1
+
+struct PluginPart {
+    unsigned abi;
+    const char* name;
+};
+
+#define LAB4_INTEGRAL_PLUGIN(name) \
+    extern "C" const PluginPart IntegralPlugin = {LAB4_PLUGIN_ABI, name}
+
+#define LAB4_TRANSLATION_PLUGIN(name) \
+    extern "C" const PluginPart TranslationPlugin = {LAB4_PLUGIN_ABI, name}
@@ -0,0 +1,92 @@
+#include "plugin_registry.h"
+
+#include <algorithm>
+#include <iostream>
+#include <dirent.h>
+#include <dlfcn.h>
+
+PluginRegistry::~PluginRegistry() {
+    active_.store(nullptr);
+    for (auto& plugin : plugins_) {
+        dlclose(plugin->handle);
+    }
+}
+
+static bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+size_t PluginRegistry::load(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        std::cerr << "Error opening plugin directory: " << dir << std::endl;
+        return 0;
+    }
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(d)) {
+        if (ends_with(entry->d_name, ".so")) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string& name : names) {
+        std::string path = dir + "/" + name;
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            std::cerr << "Error loading library: " << dlerror() << std::endl;
+            continue;
+        }
+
+        auto* integral = (const PluginPart*)dlsym(handle, "IntegralPlugin");
+        auto* translation = (const PluginPart*)dlsym(handle, "TranslationPlugin");
+        if (!integral || !translation) {
+            // Not a Lab4 plugin, e.g. lib_radix.so
+            dlclose(handle);
+            continue;
+        }
+        if (integral->abi != LAB4_PLUGIN_ABI || translation->abi != LAB4_PLUGIN_ABI) {
+            std::cerr << "Skipping " << path << ": plugin ABI " << integral->abi << "/"
+                      << translation->abi << ", expected " << LAB4_PLUGIN_ABI << std::endl;
+            dlclose(handle);
+            continue;
+        }
+
+        auto plugin = std::make_unique<PluginTable>();
+        plugin->index = plugins_.size();
+        plugin->path = path;
+        plugin->method = integral->name;
+        plugin->base = translation->name;
+        plugin->SinIntegral = (IntFunc)dlsym(handle, "SinIntegral");
+        plugin->Translation = (TranslationFunc)dlsym(handle, "Translation");
+        plugin->TranslationTo = (TranslationToFunc)dlsym(handle, "TranslationTo");
+        plugin->handle = handle;
+        if (!plugin->SinIntegral || !plugin->Translation || !plugin->TranslationTo) {
+            std::cerr << "Skipping " << path << ": missing symbols" << std::endl;
+            dlclose(handle);
+            continue;
+        }
+        plugins_.push_back(std::move(plugin));
+    }
+
+    if (!plugins_.empty() && !active_.load()) {
+        active_.store(plugins_.front().get(), std::memory_order_release);
+    }
+    return plugins_.size();
+}
+
+const PluginTable& PluginRegistry::switch_next() {
+    const PluginTable* current = active_.load(std::memory_order_acquire);
+    const PluginTable* next;
+    do {
+        next = plugins_[(current->index + 1) % plugins_.size()].get();
+    } while (!active_.compare_exchange_weak(current, next, std::memory_order_acq_rel));
+    return *next;
+}
+
+const PluginTable& PluginRegistry::select(size_t i) {
+    const PluginTable* next = plugins_[i % plugins_.size()].get();
+    active_.store(next, std::memory_order_release);
+    return *next;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "plugin.h"
+
+typedef float (*IntFunc)(float, float, float);
+typedef char* (*TranslationFunc)(long);
+typedef int (*TranslationToFunc)(long, char*, int);
+
+// Everything a caller needs from one loaded library. Tables never move or
+// get freed while the registry lives, so a pointer read from active() stays
+// valid even if another thread switches libraries mid-call.
+struct PluginTable {
+    size_t index;
+    std::string path;
+    const char* method;
+    const char* base;
+    IntFunc SinIntegral;
+    TranslationFunc Translation;
+    TranslationToFunc TranslationTo;
+    void* handle;
+};
+
+class PluginRegistry {
+public:
+    PluginRegistry() = default;
+    ~PluginRegistry();
+
+    PluginRegistry(const PluginRegistry&) = delete;
+    PluginRegistry& operator=(const PluginRegistry&) = delete;
+
+    // dlopens every *.so in dir that carries matching plugin descriptors and
+    // keeps it resident. Returns the number of libraries loaded.
+    size_t load(const std::string& dir);
+
+    size_t size() const { return plugins_.size(); }
+    const PluginTable& at(size_t i) const { return *plugins_[i]; }
+
+    const PluginTable& active() const {
+        return *active_.load(std::memory_order_acquire);
+    }
+
+    // Both are a single atomic pointer swap
+    const PluginTable& switch_next();
+    const PluginTable& select(size_t i);
+
+private:
+    std::vector<std::unique_ptr<PluginTable>> plugins_;
+    std::atomic<const PluginTable*> active_{nullptr};
+};
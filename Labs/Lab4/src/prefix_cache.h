@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "sin_simd.h"
+
+// Cached SinIntegral for workloads that keep asking about overlapping ranges
+// with the same step. For every (e, grid origin) the cache keeps prefix sums
+// of the panel values, P(j) = sum of panels [0, j), extended lazily in both
+// directions as queries reach further out. A query then costs two lookups:
+// the grid-aligned interior is P(b) - P(a), and any unaligned remainder at
+// either edge is integrated as one partial panel with the same rule.
+//
+// Origins are bucketed to e / CACHE_ORIGIN_BUCKETS so that slightly
+// different starting points share a grid. Tables are evicted least recently
+// used first once they exceed the byte limit.
+
+#define CACHE_DEFAULT_LIMIT (64UL << 20)
+#define CACHE_ORIGIN_BUCKETS 16
+#define CACHE_ALIGN_TOLERANCE 1e-9
+#define CACHE_FILL_BLOCK 4096
+
+struct CacheStats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long bytes;
+    unsigned long grids;
+};
+
+// out[j] = sin(start + (first + j) * e) for j in [0, n)
+static inline void sin_fill(double start, double e, long first, long n, double* out) {
+    const v8d lane = {0, 1, 2, 3, 4, 5, 6, 7};
+    long j = 0;
+    for (; j + 8 <= n; j += 8) {
+        v8d s = sin_v8d_checked(start + (static_cast<double>(first + j) + lane) * e);
+        std::memcpy(out + j, &s, sizeof(s));
+    }
+    for (; j < n; j++) {
+        out[j] = std::sin(start + static_cast<double>(first + j) * e);
+    }
+}
+
+// Midpoint rule: panel i covers [x_i, x_i + e] and samples its middle
+struct RectPanels {
+    static void panels(double origin, double e, long first, long n, double* out) {
+        sin_fill(origin + e / 2.0, e, first, n, out);
+        for (long j = 0; j < n; j++) out[j] *= e;
+    }
+
+    static double partial(double a, double b) {
+        return std::sin((a + b) / 2.0) * (b - a);
+    }
+};
+
+// Trapezoid rule: panel i averages the sines at both of its ends
+struct TrapPanels {
+    static void panels(double origin, double e, long first, long n, double* out) {
+        double edge[2];
+        sin_fill(origin, e, first, n, out);
+        sin_fill(origin, e, first + n, 1, edge);
+        for (long j = 0; j < n; j++) {
+            double next = j + 1 < n ? out[j + 1] : edge[0];
+            out[j] = (out[j] + next) / 2.0 * e;
+        }
+    }
+
+    static double partial(double a, double b) {
+        return (std::sin(a) + std::sin(b)) / 2.0 * (b - a);
+    }
+};
+
+template <typename Rule>
+class PrefixCache {
+public:
+    double integral(double A, double B, double e) {
+        if (!(e > 0.0) || !(B > A)) {
+            return 0.0;
+        }
+
+        // Grid x_i = origin + i * e, with the origin bucketed inside [0, e)
+        double bucket = e / CACHE_ORIGIN_BUCKETS;
+        double offset = A - std::floor(A / e + CACHE_ALIGN_TOLERANCE) * e;
+        double origin = std::floor(offset / bucket + CACHE_ALIGN_TOLERANCE) * bucket;
+        if (origin >= e) origin = 0.0;
+
+        long a = first_index_at_or_after(A, origin, e);
+        long b = last_index_at_or_before(B, origin, e);
+        if (a > b) {
+            return Rule::partial(A, B);
+        }
+
+        double result = 0.0;
+        double grid_a = origin + a * e;
+        double grid_b = origin + b * e;
+        if (grid_a > A) result += Rule::partial(A, grid_a);
+        if (grid_b < B) result += Rule::partial(grid_b, B);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Grid* grid = find(e, origin);
+        bool hit = grid && grid->covers(a, b);
+        if (hit) {
+            hits_++;
+        } else {
+            misses_++;
+            bool inserted = !grid;
+            if (inserted) grid = insert(e, origin);
+            if (!extend(*grid, a, b)) {
+                // Keep no empty table around for a range that never fits
+                if (inserted) erase(grid);
+                return result + direct(origin, e, a, b);
+            }
+        }
+        return result + grid->prefix(b) - grid->prefix(a);
+    }
+
+    void set_limit(unsigned long bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_ = bytes;
+        evict(nullptr, 0);
+    }
+
+    CacheStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {hits_, misses_, bytes_, static_cast<unsigned long>(grids_.size())};
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        grids_.clear();
+        index_.clear();
+        bytes_ = 0;
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+private:
+    struct Key {
+        double e;
+        double origin;
+
+        bool operator==(const Key& other) const { return e == other.e && origin == other.origin; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            unsigned long a, b;
+            std::memcpy(&a, &key.e, sizeof(a));
+            std::memcpy(&b, &key.origin, sizeof(b));
+            return a * 0x9E3779B97F4A7C15UL ^ (b + (a << 6) + (a >> 2));
+        }
+    };
+
+    // pos[j] = P(j) for j >= 0, neg[j] = -P(-j); both start at P(0) = 0
+    struct Grid {
+        Key key;
+        std::vector<double> pos{0.0};
+        std::vector<double> neg{0.0};
+
+        bool covers(long a, long b) const {
+            return (a >= 0 || static_cast<unsigned long>(-a) < neg.size()) &&
+                   (b <= 0 || static_cast<unsigned long>(b) < pos.size());
+        }
+
+        double prefix(long j) const { return j >= 0 ? pos[j] : -neg[-j]; }
+
+        // What the vectors hold on to, not just what they use
+        unsigned long bytes() const { return (pos.capacity() + neg.capacity()) * sizeof(double); }
+    };
+
+    static long first_index_at_or_after(double x, double origin, double e) {
+        return static_cast<long>(std::ceil((x - origin) / e - CACHE_ALIGN_TOLERANCE));
+    }
+
+    static long last_index_at_or_before(double x, double origin, double e) {
+        return static_cast<long>(std::floor((x - origin) / e + CACHE_ALIGN_TOLERANCE));
+    }
+
+    Grid* find(double e, double origin) {
+        auto it = index_.find(Key{e, origin});
+        if (it == index_.end()) return nullptr;
+        grids_.splice(grids_.begin(), grids_, it->second);
+        return &*it->second;
+    }
+
+    Grid* insert(double e, double origin) {
+        Grid grid;
+        grid.key = Key{e, origin};
+        grids_.push_front(std::move(grid));
+        index_[grids_.front().key] = grids_.begin();
+        bytes_ += grids_.front().bytes();
+        return &grids_.front();
+    }
+
+    void erase(Grid* grid) {
+        auto it = index_.find(grid->key);
+        bytes_ -= grid->bytes();
+        grids_.erase(it->second);
+        index_.erase(it);
+    }
+
+    // Drops least recently used grids other than keep until needed more
+    // bytes fit under the limit. Returns false if that is impossible.
+    bool evict(const Grid* keep, unsigned long needed) {
+        auto it = grids_.end();
+        while (bytes_ + needed > limit_ && it != grids_.begin()) {
+            --it;
+            if (&*it == keep) continue;
+            bytes_ -= it->bytes();
+            index_.erase(it->key);
+            it = grids_.erase(it);
+        }
+        return bytes_ + needed <= limit_;
+    }
+
+    bool extend(Grid& grid, long a, long b) {
+        unsigned long pos_size = b > 0 ? static_cast<unsigned long>(b) + 1 : 1;
+        unsigned long neg_size = a < 0 ? static_cast<unsigned long>(-a) + 1 : 1;
+        pos_size = std::max<unsigned long>(pos_size, grid.pos.size());
+        neg_size = std::max<unsigned long>(neg_size, grid.neg.size());
+        // Reserved to exactly the sizes needed, so the tables grow by what
+        // the query asks for and never by the doubling of push_back
+        unsigned long old_bytes = grid.bytes();
+        unsigned long pos_capacity = std::max<unsigned long>(pos_size, grid.pos.capacity());
+        unsigned long neg_capacity = std::max<unsigned long>(neg_size, grid.neg.capacity());
+        unsigned long needed = (pos_capacity + neg_capacity) * sizeof(double) - old_bytes;
+        if (!evict(&grid, needed)) {
+            return false;
+        }
+        grid.pos.reserve(pos_capacity);
+        grid.neg.reserve(neg_capacity);
+
+        double e = grid.key.e;
+        double origin = grid.key.origin;
+        double panels[CACHE_FILL_BLOCK];
+        while (grid.pos.size() < pos_size) {
+            long first = static_cast<long>(grid.pos.size()) - 1;
+            long n = std::min<long>(CACHE_FILL_BLOCK, pos_size - grid.pos.size());
+            Rule::panels(origin, e, first, n, panels);
+            for (long j = 0; j < n; j++) grid.pos.push_back(grid.pos.back() + panels[j]);
+        }
+        while (grid.neg.size() < neg_size) {
+            // Panels -size .. -(size - n) - 1, accumulated from the right
+            long n = std::min<long>(CACHE_FILL_BLOCK, neg_size - grid.neg.size());
+            long first = -static_cast<long>(grid.neg.size()) - n + 1;
+            Rule::panels(origin, e, first, n, panels);
+            for (long j = n - 1; j >= 0; j--) grid.neg.push_back(grid.neg.back() + panels[j]);
+        }
+        bytes_ += grid.bytes() - old_bytes;
+        return true;
+    }
+
+    // Used when a single table would not fit under the limit
+    static double direct(double origin, double e, long a, long b) {
+        double panels[CACHE_FILL_BLOCK];
+        double sum = 0.0;
+        for (long first = a; first < b; first += CACHE_FILL_BLOCK) {
+            long n = std::min<long>(CACHE_FILL_BLOCK, b - first);
+            Rule::panels(origin, e, first, n, panels);
+            for (long j = 0; j < n; j++) sum += panels[j];
+        }
+        return sum;
+    }
+
+    std::mutex mutex_;
+    std::list<Grid> grids_;
+    std::unordered_map<Key, typename std::list<Grid>::iterator, KeyHash> index_;
+    unsigned long limit_{CACHE_DEFAULT_LIMIT};
+    unsigned long bytes_{0};
+    unsigned long hits_{0};
+    unsigned long misses_{0};
+};
+
+// Cache exported next to a library's SinIntegral, with Panels the same rule:
+//   SinIntegralCached     - O(1) for repeated queries with the same step, the
+//                           unaligned edges integrated as partial panels
+//   SinIntegralCacheStats - any pointer may be null
+//   SinIntegralCacheLimit - memory bound for all tables, CACHE_DEFAULT_LIMIT
+//                           by default
+#define LAB4_CACHE_EXPORTS(Panels) \
+    static PrefixCache<Panels> sin_cache; \
+    \
+    extern "C" float SinIntegralCached(float A, float B, float e) { \
+        return static_cast<float>(sin_cache.integral(A, B, e)); \
+    } \
+    \
+    extern "C" void SinIntegralCacheStats(unsigned long* hits, unsigned long* misses, unsigned long* bytes) { \
+        CacheStats stats = sin_cache.stats(); \
+        if (hits) *hits = stats.hits; \
+        if (misses) *misses = stats.misses; \
+        if (bytes) *bytes = stats.bytes; \
+    } \
+    \
+    extern "C" void SinIntegralCacheLimit(unsigned long bytes) { \
+        sin_cache.set_limit(bytes); \
+    }
@@ -1,10 +1,24 @@
 #include <iostream>
+#include "batch.h"
 
 extern "C" float SinIntegral(float A, float B, float e);
 extern "C" char* Translation(long x);
+extern "C" int TranslationTo(long x, char* buf, int size);
 
-int main()
+int main(int argc, char* argv[])
 {
+    BatchOptions batch;
+    std::vector<std::string> rest;
+    if (!parse_batch_options(argc, argv, batch, rest) || !rest.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--batch [FILE]] [--threads N]" << std::endl;
+        return 1;
+    }
+    if (batch.enabled)
+    {
+        return run_batch(batch, SinIntegral, TranslationTo);
+    }
+
     int prog;
     while (true)
     {
@@ -20,12 +34,16 @@ int main()
             std::cout << "Calculated integral: " << SinIntegral(A, B, e) << "\n\n";
             break;
         case 2:
+        {
             long x;
             std::cout << "Enter x: ";
             std::cin >> x;
 
-            std::cout << "Translationed number: " << Translation(x) << "\n\n";
+            char* number = Translation(x);
+            std::cout << "Translationed number: " << number << "\n\n";
+            delete[] number;
             break;
+        }
         default:
             std::cout << "Exit\n";
             return 0;
@@ -1,72 +1,69 @@
 #include <iostream>
-#include <dlfcn.h>
+#include <string>
+#include "batch.h"
+#include "jit.h"
+#include "plugin_registry.h"
 
-int main()
+int main(int argc, char* argv[])
 {
     int prog = 1;
-    int real = 1;
-    void *lib = nullptr;
-
-    typedef float (*IntFunc)(float, float, float);
-    typedef char* (*TranslationFunc)(long);
-
-    IntFunc SinIntegral;
-    TranslationFunc Translation;
-
-    // Initial library load
-    lib = dlopen("./lib_pr2_1.so", RTLD_LAZY);
-    if (!lib)
+    BatchOptions batch;
+    std::vector<std::string> rest;
+    if (!parse_batch_options(argc, argv, batch, rest) || rest.size() > 2)
     {
-        std::cerr << "Error loading initial library: " << dlerror() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [plugin_dir] [library] [--batch [FILE]] [--threads N]" << std::endl;
         return 1;
     }
-    std::cout << "Library is loaded\n";
+    const char* plugin_dir = !rest.empty() ? rest[0].c_str() : ".";
 
-    SinIntegral = (IntFunc)dlsym(lib, "SinIntegral");
-    Translation = (TranslationFunc)dlsym(lib, "Translation");
-    if (!SinIntegral || !Translation)
+    // Every library in the directory is loaded once and stays resident;
+    // switching only swaps the active function table.
+    PluginRegistry registry;
+    if (registry.load(plugin_dir) == 0)
     {
-        std::cerr << "Failed to load symbols: " << dlerror() << std::endl;
-        dlclose(lib);
+        std::cerr << "Error loading libraries: no plugins found in " << plugin_dir << std::endl;
         return 1;
     }
+    if (rest.size() > 1)
+    {
+        // Start with the named library, e.g. lib_pr2_2.so
+        for (size_t i = 0; i < registry.size(); i++)
+        {
+            if (registry.at(i).path == std::string(plugin_dir) + "/" + rest[1])
+            {
+                registry.select(i);
+            }
+        }
+        if (registry.active().path != std::string(plugin_dir) + "/" + rest[1])
+        {
+            std::cerr << "Error: library " << rest[1] << " is not a loaded plugin" << std::endl;
+            return 1;
+        }
+    }
+    if (batch.enabled)
+    {
+        const PluginTable& lib = registry.active();
+        return run_batch(batch, lib.SinIntegral, lib.TranslationTo);
+    }
 
+    std::cout << "Libraries are loaded:";
+    for (size_t i = 0; i < registry.size(); i++)
+    {
+        std::cout << " " << registry.at(i).path;
+    }
+    std::cout << "\n";
+
+    ExprJit jit;
     while (true)
     {
-        std::cout << "Input program code:\n 0 -> Library switch\n 1 -> Calculate integral\n 2 -> Translation\n-1 -> Exit\n";
+        std::cout << "Input program code:\n 0 -> Library switch\n 1 -> Calculate integral\n 2 -> Translation\n 3 -> Integrate expression\n-1 -> Exit\n";
         std::cin >> prog;
+        const PluginTable& lib = registry.active();
         switch (prog)
         {
         case 0:
-            dlclose(lib); // Close the current library
-            if (real == 1)
-            {
-                lib = dlopen("./lib_pr2_2.so", RTLD_LAZY);
-                real = 2;
-            }
-            else
-            {
-                lib = dlopen("./lib_pr2_1.so", RTLD_LAZY);
-                real = 1;
-            }
-
-            if (!lib)
-            { // Check for dlopen errors
-                std::cerr << "Error loading library: " << dlerror() << std::endl;
-                return 1;
-            }
             //system("clear");
-            std::cout << "Library switched succesfully!\n";
-
-            // Reload symbols
-            SinIntegral = (IntFunc)dlsym(lib, "SinIntegral");
-            Translation = (TranslationFunc)dlsym(lib, "Translation");
-            if (!SinIntegral || !Translation)
-            {
-                std::cerr << "Failed to load symbols: " << dlerror() << std::endl;
-                dlclose(lib);
-                return 1;
-            }
+            std::cout << "Library switched succesfully to " << registry.switch_next().path << "!\n";
             break;
         case 1:
             //system("clear");
@@ -74,28 +71,56 @@ int main()
             std::cout << "Enter A, B and e: ";
             std::cin >> A >> B >> e;
 
-            if (real == 1)
-                std::cout << "Counting integral with rectangles\n";
-            else
-                std::cout << "Counting integral with trapeze\n";
-            std::cout << "Integral: " << SinIntegral(A, B, e) << "\n\n";
+            std::cout << "Counting integral with " << lib.method << "\n";
+            std::cout << "Integral: " << lib.SinIntegral(A, B, e) << "\n\n";
             break;
         case 2:
+        {
             //system("clear");
             long x;
             std::cout << "Enter x: ";
             std::cin >> x;
 
-            if (real == 1)
-                std::cout << "Translationing to binary\n";
-            else
-                std::cout << "Translationing to trinity\n";
-            std::cout << "Result is: " << Translation(x) << "\n\n";
+            std::cout << "Translationing to " << lib.base << "\n";
+            char* number = lib.Translation(x);
+            std::cout << "Result is: " << number << "\n\n";
+            delete[] number;
             break;
+        }
+        case 3:
+        {
+            //system("clear");
+            std::string expr, rule_name;
+            double A, B, e;
+            std::cout << "Enter f(x): ";
+            std::cin >> std::ws;
+            std::getline(std::cin, expr);
+            std::cout << "Enter rule (rectangles, trapeze, simpson): ";
+            std::cin >> rule_name;
+            std::cout << "Enter A, B and e: ";
+            std::cin >> A >> B >> e;
+
+            JitRule rule;
+            if (!parse_jit_rule(rule_name, rule))
+            {
+                std::cout << "Unknown rule " << rule_name << "\n\n";
+                break;
+            }
+            bool cached;
+            ExprIntegralFunc integral = jit.compile(expr, rule, &cached);
+            if (!integral)
+            {
+                std::cout << "\n";
+                break;
+            }
+            std::cout << "Counting integral with " << jit_rule_name(rule)
+                      << (cached ? " (cached)" : " (compiled)") << "\n";
+            std::cout << "Integral: " << integral(A, B, e) << "\n\n";
+            break;
+        }
         default:
             std::cout << "Exit\n";
-            dlclose(lib);
             return 0;
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <dlfcn.h>
+
+// Cost of reaching a given accuracy with each SinIntegral library: the
+// fixed-step rules halve e until the error is small enough, the adaptive one
+// tightens its tolerance. Evaluations are counted as sin() calls.
+
+typedef float (*IntFunc)(float, float, float);
+typedef unsigned long (*EvalFunc)();
+
+const float A = 0.0f;
+const float B = 10.0f;
+const float MIN_STEP = 1e-7f;
+
+struct Attempt {
+    float value;
+    double seconds;
+};
+
+Attempt timed_call(IntFunc f, float e) {
+    Attempt best{0.0f, 1e30};
+    for (int rep = 0; rep < 3; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        float value = f(A, B, e);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best.seconds) best = {value, elapsed.count()};
+    }
+    return best;
+}
+
+int main()
+{
+    const char* libraries[] = {"./lib_pr2_1.so", "./lib_pr2_2.so", "./lib_pr2_3.so"};
+    const double targets[] = {1e-2, 1e-3, 1e-4, 1e-5, 1e-6};
+    const double exact = std::cos(A) - std::cos(B);
+
+    std::cout << std::left << std::setw(18) << "library" << std::setw(10) << "target"
+              << std::setw(12) << "e" << std::setw(14) << "error"
+              << std::setw(14) << "evaluations" << "time_ms\n";
+
+    for (const char* path : libraries)
+    {
+        void* lib = dlopen(path, RTLD_NOW);
+        if (!lib)
+        {
+            std::cerr << "Error loading library: " << dlerror() << std::endl;
+            return 1;
+        }
+        IntFunc SinIntegral = (IntFunc)dlsym(lib, "SinIntegral");
+        EvalFunc Evaluations = (EvalFunc)dlsym(lib, "SinIntegralEvaluations");
+        if (!SinIntegral)
+        {
+            std::cerr << "Failed to load symbols: " << dlerror() << std::endl;
+            return 1;
+        }
+
+        for (double target : targets)
+        {
+            float e = Evaluations ? static_cast<float>(target) : 0.5f;
+            Attempt attempt = timed_call(SinIntegral, e);
+            while (std::fabs(attempt.value - exact) > target && e > MIN_STEP)
+            {
+                e /= Evaluations ? 10.0f : 2.0f;
+                attempt = timed_call(SinIntegral, e);
+            }
+
+            unsigned long evaluations;
+            if (Evaluations)
+            {
+                unsigned long before = Evaluations();
+                SinIntegral(A, B, e);
+                evaluations = Evaluations() - before;
+            }
+            else
+            {
+                evaluations = static_cast<unsigned long>((B - A) / e) + 1;
+            }
+
+            bool reached = std::fabs(attempt.value - exact) <= target;
+            std::cout << std::left << std::setw(18) << path << std::setw(10) << target
+                      << std::setw(12) << e << std::setw(14) << std::fabs(attempt.value - exact)
+                      << std::setw(14) << evaluations << attempt.seconds * 1e3
+                      << (reached ? "" : "  (not reached)") << "\n";
+        }
+        dlclose(lib);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstring>
+#include <utility>
+
+// Base-N conversion with tables generated at compile time for every base.
+// Long runs of digits are peeled off Base^K at a time through the chunk
+// table; the remaining head goes through the digit-pair table.
+
+const char RADIX_DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// Sign, 64 binary digits and the terminating zero
+const int RADIX_MAX_LENGTH = 66;
+
+// Largest k with Base^k <= 4096 and a table of at most 16 KB
+constexpr int chunk_digits(unsigned base) {
+    int k = 1;
+    unsigned long power = base;
+    while (power * base <= 4096 && power * base * (k + 1) <= 16384) {
+        power *= base;
+        k++;
+    }
+    return k;
+}
+
+constexpr unsigned long int_pow(unsigned base, int k) {
+    unsigned long power = 1;
+    for (int i = 0; i < k; i++) power *= base;
+    return power;
+}
+
+template <unsigned Base>
+struct RadixTables {
+    static constexpr int K = chunk_digits(Base);
+    static constexpr unsigned long CHUNK = int_pow(Base, K);
+    static constexpr unsigned long PAIR = Base * Base;
+
+    char chunk[CHUNK][K];
+    char pair[PAIR][2];
+
+    constexpr RadixTables() : chunk(), pair() {
+        for (unsigned long v = 0; v < CHUNK; v++) {
+            unsigned long rest = v;
+            for (int i = K - 1; i >= 0; i--) {
+                chunk[v][i] = RADIX_DIGITS[rest % Base];
+                rest /= Base;
+            }
+        }
+        for (unsigned long v = 0; v < PAIR; v++) {
+            pair[v][0] = RADIX_DIGITS[v / Base];
+            pair[v][1] = RADIX_DIGITS[v % Base];
+        }
+    }
+};
+
+template <unsigned Base>
+inline constexpr RadixTables<Base> RADIX_TABLES{};
+
+// Writes the digits of value so that they end right before end and returns
+// where they start. Divisions are by compile-time constants, so they turn
+// into multiplications.
+template <unsigned Base>
+inline char* radix_digits(unsigned long value, char* end) {
+    typedef RadixTables<Base> Tables;
+    const Tables& tables = RADIX_TABLES<Base>;
+
+    char* pos = end;
+    while (value >= Tables::CHUNK) {
+        pos -= Tables::K;
+        std::memcpy(pos, tables.chunk[value % Tables::CHUNK], Tables::K);
+        value /= Tables::CHUNK;
+    }
+    while (value >= Base) {
+        pos -= 2;
+        std::memcpy(pos, tables.pair[value % Tables::PAIR], 2);
+        value /= Tables::PAIR;
+    }
+    if (value > 0 || pos == end) {
+        *--pos = RADIX_DIGITS[value];
+    }
+    return pos;
+}
+
+// Writes x in the given base as sign and magnitude. Returns the length
+// without the terminating zero, or -1 if size is too small.
+template <unsigned Base>
+inline int to_radix(long x, char* buf, int size) {
+    static_assert(Base >= 2 && Base <= 36, "base must be in [2, 36]");
+    unsigned long value = x < 0 ? 0UL - static_cast<unsigned long>(x) : static_cast<unsigned long>(x);
+
+    char temp[RADIX_MAX_LENGTH];
+    char* end = temp + RADIX_MAX_LENGTH;
+    char* start = radix_digits<Base>(value, end);
+    int digits = static_cast<int>(end - start);
+    int length = digits + (x < 0 ? 1 : 0);
+    if (length + 1 > size) {
+        return -1;
+    }
+
+    int j = 0;
+    if (x < 0) {
+        buf[j++] = '-';
+    }
+    std::memcpy(buf + j, start, digits);
+    buf[length] = '\0';
+    return length;
+}
+
+typedef int (*RadixFunc)(long, char*, int);
+
+template <unsigned... Bases>
+constexpr auto make_radix_table(std::integer_sequence<unsigned, Bases...>) {
+    struct Table {
+        RadixFunc convert[sizeof...(Bases) + 2];
+    } table{{nullptr, nullptr, &to_radix<Bases + 2>...}};
+    return table;
+}
+
+// Converter for every base in [2, 36], indexed by the base itself
+inline constexpr auto RADIX_CONVERTERS = make_radix_table(std::make_integer_sequence<unsigned, 35>());
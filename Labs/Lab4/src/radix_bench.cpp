@@ -0,0 +1,98 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <vector>
+#include <dlfcn.h>
+
+// Nanoseconds per conversion: the generic lib_radix.so against the base-2
+// and base-3 Translation libraries (allocating and caller-buffer forms).
+
+typedef char* (*TranslationFunc)(long);
+typedef int (*TranslationToFunc)(long, char*, int);
+typedef int (*TranslationBaseFunc)(long, int, char*, int);
+
+const int COUNT = 1 << 20;
+const int ROUNDS = 5;
+
+template <typename Body>
+double ns_per_op(const std::vector<long>& xs, Body body) {
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (long x : xs) body(x);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / xs.size());
+    }
+    return best;
+}
+
+void* load(const char* path) {
+    void* lib = dlopen(path, RTLD_NOW);
+    if (!lib) {
+        std::cerr << "Error loading library: " << dlerror() << std::endl;
+        exit(1);
+    }
+    return lib;
+}
+
+void report(const char* name, double ns) {
+    std::cout << std::left << std::setw(36) << name << std::fixed << std::setprecision(2) << ns << " ns\n";
+}
+
+int main()
+{
+    std::mt19937_64 gen(42);
+    std::vector<long> xs(COUNT);
+    for (long& x : xs) {
+        // Spread magnitudes over every bit length
+        x = static_cast<long>(gen() >> (gen() % 64));
+    }
+
+    TranslationBaseFunc TranslationBase = (TranslationBaseFunc)dlsym(load("./lib_radix.so"), "TranslationBase");
+    const char* libraries[] = {"./lib_pr2_1.so", "./lib_pr2_2.so"};
+    const int bases[] = {2, 3};
+
+    char buf[80];
+    volatile char sink = 0;
+    for (int i = 0; i < 2; i++) {
+        void* lib = load(libraries[i]);
+        TranslationFunc Translation = (TranslationFunc)dlsym(lib, "Translation");
+        TranslationToFunc TranslationTo = (TranslationToFunc)dlsym(lib, "TranslationTo");
+        if (!Translation || !TranslationTo || !TranslationBase) {
+            std::cerr << "Failed to load symbols: " << dlerror() << std::endl;
+            return 1;
+        }
+
+        std::cout << "base " << bases[i] << " (" << libraries[i] << ")\n";
+        report("  Translation + delete[]", ns_per_op(xs, [&](long x) {
+            char* s = Translation(x);
+            sink = sink + s[0];
+            delete[] s;
+        }));
+        report("  TranslationTo", ns_per_op(xs, [&](long x) {
+            TranslationTo(x, buf, sizeof(buf));
+            sink = sink + buf[0];
+        }));
+        report("  TranslationBase", ns_per_op(xs, [&](long x) {
+            TranslationBase(x, bases[i], buf, sizeof(buf));
+            sink = sink + buf[0];
+        }));
+    }
+
+    std::cout << "other bases (lib_radix.so)\n";
+    for (int base : {8, 10, 16, 36}) {
+        std::string name = "  TranslationBase base " + std::to_string(base);
+        report(name.c_str(), ns_per_op(xs, [&](long x) {
+            TranslationBase(x, base, buf, sizeof(buf));
+            sink = sink + buf[0];
+        }));
+    }
+    report("  snprintf %ld (base 10 reference)", ns_per_op(xs, [&](long x) {
+        snprintf(buf, sizeof(buf), "%ld", x);
+        sink = sink + buf[0];
+    }));
+    return 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "sin_simd.h"
+
+// SinIntegral compiled once per instruction set. A library defines a Rule
+// with a static always-inline integral(), and its ifunc resolver calls
+// select_sin_integral<Rule>() once when the library is loaded, so the
+// exported symbol goes straight to the best variant for the running CPU.
+// Code that calls sin_sum() from elsewhere, like the worker threads of the
+// parallel libraries, picks its variant with select_sin_sum() instead.
+
+typedef float (*IntFunc)(float, float, float);
+typedef double (*SumFunc)(double, double, long, long);
+
+enum class SinIsa { Baseline, Avx2, Avx512 };
+
+#if defined(__x86_64__)
+
+static inline SinIsa detect_sin_isa() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SinIsa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SinIsa::Avx2;
+    return SinIsa::Baseline;
+}
+
+template <typename Rule>
+__attribute__((target("avx512f")))
+float sin_integral_avx512(float A, float B, float e) {
+    return Rule::integral(A, B, e);
+}
+
+template <typename Rule>
+__attribute__((target("avx2,fma")))
+float sin_integral_avx2(float A, float B, float e) {
+    return Rule::integral(A, B, e);
+}
+
+__attribute__((target("avx512f")))
+static double sin_sum_avx512(double start, double e, long first, long n) {
+    return sin_sum(start, e, first, n);
+}
+
+__attribute__((target("avx2,fma")))
+static double sin_sum_avx2(double start, double e, long first, long n) {
+    return sin_sum(start, e, first, n);
+}
+
+#else
+
+static inline SinIsa detect_sin_isa() {
+    return SinIsa::Baseline;
+}
+
+#endif
+
+// SSE2 on x86-64, whatever the compiler targets elsewhere
+template <typename Rule>
+float sin_integral_baseline(float A, float B, float e) {
+    return Rule::integral(A, B, e);
+}
+
+template <typename Rule>
+IntFunc select_sin_integral() {
+    switch (detect_sin_isa()) {
+#if defined(__x86_64__)
+    case SinIsa::Avx512:
+        return sin_integral_avx512<Rule>;
+    case SinIsa::Avx2:
+        return sin_integral_avx2<Rule>;
+#endif
+    default:
+        return sin_integral_baseline<Rule>;
+    }
+}
+
+static double sin_sum_baseline(double start, double e, long first, long n) {
+    return sin_sum(start, e, first, n);
+}
+
+static inline SumFunc select_sin_sum() {
+    switch (detect_sin_isa()) {
+#if defined(__x86_64__)
+    case SinIsa::Avx512:
+        return sin_sum_avx512;
+    case SinIsa::Avx2:
+        return sin_sum_avx2;
+#endif
+    default:
+        return sin_sum_baseline;
+    }
+}
+
+static inline const char* sin_isa_name() {
+    switch (detect_sin_isa()) {
+    case SinIsa::Avx512:
+        return "avx512";
+    case SinIsa::Avx2:
+        return "avx2";
+    default:
+#if defined(__x86_64__)
+        return "sse2";
+#else
+        return "baseline";
+#endif
+    }
+}
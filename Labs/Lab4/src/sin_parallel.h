@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include "sin_dispatch.h"
+#include "worker_pool.h"
+
+// Samples per chunk. The chunk grid depends only on the sample count, and
+// chunk sums are combined pairwise in index order, so results are
+// bit-identical for every thread count.
+#define SIN_CHUNK (1L << 15)
+
+// One pool per library; the exported SinIntegralSetThreads() resizes it.
+static WorkerPool sin_pool;
+
+// Chunk sums for the running CPU, chosen when the library is loaded
+static const SumFunc sin_chunk_sum = select_sin_sum();
+
+static double parallel_sin_sum(double start, double e, long first, long n) {
+    if (n <= 0) return 0.0;
+    long chunks = (n + SIN_CHUNK - 1) / SIN_CHUNK;
+    std::vector<double> partial(chunks);
+    sin_pool.run(chunks, [&](long c) {
+        long offset = c * SIN_CHUNK;
+        long len = std::min(SIN_CHUNK, n - offset);
+        partial[c] = sin_chunk_sum(start, e, first + offset, len);
+    });
+    return pairwise_sum(partial.data(), chunks);
+}
+
+// Pool controls exported next to a library's parallel SinIntegral:
+//   SinIntegralSetThreads - n <= 0 selects one thread per hardware thread
+//   SinIntegralGetThreads - current pool size
+//   SinIntegralIsa        - instruction set the chunk sums were resolved to
+#define LAB4_THREAD_EXPORTS() \
+    extern "C" void SinIntegralSetThreads(int n) { \
+        sin_pool.set_threads(n); \
+    } \
+    \
+    extern "C" int SinIntegralGetThreads() { \
+        return sin_pool.threads(); \
+    } \
+    \
+    extern "C" const char* SinIntegralIsa() { \
+        return sin_isa_name(); \
+    }
@@ -1,47 +1,50 @@
-extern "C" char* Translation(long x) {
-    if (x == 0) {
-        char* result = new char[2];
-        result[0] = '0';
-        result[1] = '\0';
-        return result;
-    }
+#include <cstring>
+#include "plugin.h"
+#include "translation.h"
 
-    const int BITS = 64;
-    char temp[BITS];
+LAB4_TRANSLATION_PLUGIN("binary");
 
-    bool isNegative = (x < 0);
-    if (isNegative) {
-        x = -(x + 1);
-    }
+// Largest output: sign, 64 digits and the terminating zero
+const int MAX_LENGTH = 66;
+
+// Eight binary digits for every byte value
+struct ByteDigits {
+    char digits[256][8];
 
-    int pos = 0;
-    for (int i = BITS - 1; i >= 0; i--) {
-        if (isNegative) {
-            temp[i] = ((x & 1) ^ 1) + '0';
-        } else {
-            temp[i] = (x & 1) + '0';
+    constexpr ByteDigits() : digits() {
+        for (int b = 0; b < 256; b++) {
+            for (int i = 0; i < 8; i++) {
+                digits[b][i] = ((b >> (7 - i)) & 1) + '0';
+            }
         }
-        x >>= 1;
     }
-
-    int firstDigit = 0;
-    while (firstDigit < BITS && temp[firstDigit] == '0') {
-        firstDigit++;
+};
+
+constexpr ByteDigits BYTE_DIGITS;
+
+// Writes x in base 2 to buf and returns the length without the terminating
+// zero, or -1 if size is too small. Negative numbers are written as a minus
+// sign followed by all 64 bits of their two's complement form.
+extern "C" int TranslationTo(long x, char* buf, int size) {
+    unsigned long bits = static_cast<unsigned long>(x);
+    int digits = x < 0 ? 64 : 64 - __builtin_clzl(bits | 1);
+    int length = digits + (x < 0 ? 1 : 0);
+    if (length + 1 > size) {
+        return -1;
     }
-    if (firstDigit == BITS) firstDigit--;
-
-    int resultSize = BITS - firstDigit + (isNegative ? 2 : 1);
-    char* result = new char[resultSize];
 
-    int j = 0;
-    if (isNegative) {
-        result[j++] = '-';
+    char temp[64];
+    for (int byte = 0; byte < 8; byte++) {
+        std::memcpy(temp + 56 - byte * 8, BYTE_DIGITS.digits[(bits >> (byte * 8)) & 0xFF], 8);
     }
 
-    for (int i = firstDigit; i < BITS; i++) {
-        result[j++] = temp[i];
+    int j = 0;
+    if (x < 0) {
+        buf[j++] = '-';
     }
-    result[j] = '\0';
-
-    return result;
+    std::memcpy(buf + j, temp + 64 - digits, digits);
+    buf[length] = '\0';
+    return length;
 }
+
+LAB4_TRANSLATION_EXPORTS(MAX_LENGTH);
@@ -0,0 +1,20 @@
+#include "radix.h"
+#include "translation.h"
+
+// Writes x in any base from 2 to 36 (digits 0-9a-z, negative numbers as
+// sign and magnitude). Returns the length without the terminating zero, or
+// -1 if the base is out of range or size is too small.
+extern "C" int TranslationBase(long x, int base, char* buf, int size) {
+    if (base < 2 || base > 36) {
+        return -1;
+    }
+    return RADIX_CONVERTERS.convert[base](x, buf, size);
+}
+
+// Batch form of TranslationBase, packed the same way as TranslationBatch
+extern "C" long TranslationBaseBatch(const long* xs, long count, int base, char* out, long size, long* offsets) {
+    if (base < 2 || base > 36) {
+        return 0;
+    }
+    return pack_translations(xs, count, out, size, offsets, RADIX_MAX_LENGTH, RADIX_CONVERTERS.convert[base]);
+}
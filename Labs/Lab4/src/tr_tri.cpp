@@ -1,40 +1,68 @@
-extern "C" char* Translation(long x) {
-    if (x == 0) {
-        char* result = new char[2];
-        result[0] = '0';
-        result[1] = '\0';
-        return result;
-    }
+#include <cstring>
+#include "plugin.h"
+#include "translation.h"
 
-    bool isNegative = (x < 0);
-    if (isNegative) {
-        x = -x;
-    }
+LAB4_TRANSLATION_PLUGIN("trinity");
 
-    // Calculate maximum digits needed for base 3
-    // log3(2^64) ≈ 40.3, so 42 digits is enough for any long
-    const int MAX_DIGITS = 42;
-    char* temp = new char[MAX_DIGITS];
-    int pos = 0;
+// log3(2^64) ≈ 40.4, so 41 digits, a sign and the terminating zero
+const int MAX_LENGTH = 43;
 
-    while (x > 0) {
-        temp[pos++] = (x % 3) + '0';
-        x /= 3;
+// Digits peeled off per division: 3^6 = 729 fits a 4.4 KB table
+const int CHUNK_DIGITS = 6;
+const unsigned long CHUNK = 729;
+
+struct ChunkDigits {
+    char digits[CHUNK][CHUNK_DIGITS];
+    unsigned char length[CHUNK];
+
+    constexpr ChunkDigits() : digits(), length() {
+        for (unsigned long v = 0; v < CHUNK; v++) {
+            unsigned long rest = v;
+            for (int i = CHUNK_DIGITS - 1; i >= 0; i--) {
+                digits[v][i] = (rest % 3) + '0';
+                rest /= 3;
+            }
+            unsigned char n = 1;
+            for (unsigned long p = 3; p <= v; p *= 3) {
+                n++;
+            }
+            length[v] = n;
+        }
     }
+};
 
-    int resultSize = pos + (isNegative ? 2 : 1);
-    char* result = new char[resultSize];
+constexpr ChunkDigits CHUNK_DIGITS_TABLE;
 
-    int j = 0;
-    if (isNegative) {
-        result[j++] = '-';
+// Writes x in base 3 to buf and returns the length without the terminating
+// zero, or -1 if size is too small.
+extern "C" int TranslationTo(long x, char* buf, int size) {
+    bool isNegative = (x < 0);
+    unsigned long value = isNegative ? 0UL - static_cast<unsigned long>(x) : static_cast<unsigned long>(x);
+
+    char temp[MAX_LENGTH];
+    int pos = MAX_LENGTH;
+    while (value >= CHUNK) {
+        pos -= CHUNK_DIGITS;
+        std::memcpy(temp + pos, CHUNK_DIGITS_TABLE.digits[value % CHUNK], CHUNK_DIGITS);
+        value /= CHUNK;
     }
+    int head = CHUNK_DIGITS_TABLE.length[value];
+    pos -= head;
+    std::memcpy(temp + pos, CHUNK_DIGITS_TABLE.digits[value] + CHUNK_DIGITS - head, head);
 
-    for (int i = pos - 1; i >= 0; i--) {
-        result[j++] = temp[i];
+    int digits = MAX_LENGTH - pos;
+    int length = digits + (isNegative ? 1 : 0);
+    if (length + 1 > size) {
+        return -1;
     }
-    result[j] = '\0';
 
-    delete[] temp;
-    return result;
+    int j = 0;
+    if (isNegative) {
+        buf[j++] = '-';
+    }
+    std::memcpy(buf + j, temp + pos, digits);
+    buf[length] = '\0';
+    return length;
 }
+
+LAB4_TRANSLATION_EXPORTS(MAX_LENGTH);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstring>
+
+// Converts count numbers into out with convert(x, buf, size), one
+// zero-terminated string after another; offsets[i] receives the position of
+// the i-th string. convert returns the length without the terminating zero
+// or -1 if size is too small, and never needs more than max_length bytes.
+// Stops when out is full and returns how many numbers were converted.
+template <typename Convert>
+inline long pack_translations(const long* xs, long count, char* out, long size, long* offsets,
+                              int max_length, Convert convert) {
+    long pos = 0;
+    for (long i = 0; i < count; i++) {
+        long room = size - pos;
+        int length = convert(xs[i], out + pos, room < max_length ? static_cast<int>(room) : max_length);
+        if (length < 0) {
+            return i;
+        }
+        offsets[i] = pos;
+        pos += length + 1;
+    }
+    return count;
+}
+
+// TranslationBatch and Translation for a library that defines
+// TranslationTo; max_length is its longest output with the terminating zero
+#define LAB4_TRANSLATION_EXPORTS(max_length) \
+    extern "C" int TranslationTo(long x, char* buf, int size); \
+    \
+    extern "C" long TranslationBatch(const long* xs, long count, char* out, long size, long* offsets) { \
+        return pack_translations(xs, count, out, size, offsets, max_length, TranslationTo); \
+    } \
+    \
+    extern "C" char* Translation(long x) { \
+        char temp[max_length]; \
+        int length = TranslationTo(x, temp, max_length); \
+        char* result = new char[length + 1]; \
+        std::memcpy(result, temp, length + 1); \
+        return result; \
+    }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool for parallel-for jobs. Threads are started on the first
+// job that needs them and then sleep between jobs; the calling thread always
+// takes part, so a pool of n threads runs n - 1 workers.
+class WorkerPool {
+public:
+    WorkerPool() = default;
+    ~WorkerPool() { stop(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // n <= 0 means one thread per hardware thread.
+    void set_threads(int n) {
+        std::lock_guard<std::mutex> call(call_mutex_);
+        if (n <= 0) n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        if (n == threads_) return;
+        stop();
+        threads_ = n;
+    }
+
+    int threads() {
+        std::lock_guard<std::mutex> call(call_mutex_);
+        return threads_;
+    }
+
+    // Calls task(i) for every i in [0, count) and returns when all are done.
+    // Which thread runs which index is unspecified.
+    void run(long count, const std::function<void(long)>& task) {
+        std::lock_guard<std::mutex> call(call_mutex_);
+        if (threads_ <= 1 || count <= 1) {
+            for (long i = 0; i < count; i++) task(i);
+            return;
+        }
+        start();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            next_.store(0);
+            busy_ = static_cast<int>(workers_.size());
+            generation_++;
+        }
+        wake_.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        task_ = nullptr;
+    }
+
+private:
+    void start() {
+        if (!workers_.empty()) return;
+        quit_ = false;
+        for (int i = 1; i < threads_; i++) {
+            workers_.emplace_back([this] { loop(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+    void drain() {
+        long i;
+        while ((i = next_.fetch_add(1)) < count_) {
+            (*task_)(i);
+        }
+    }
+
+    void loop() {
+        unsigned long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+                if (quit_) return;
+                seen = generation_;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--busy_ == 0) done_.notify_one();
+            }
+        }
+    }
+
+    std::mutex call_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<std::thread> workers_;
+    const std::function<void(long)>* task_{nullptr};
+    long count_{0};
+    std::atomic<long> next_{0};
+    int busy_{0};
+    unsigned long generation_{0};
+    bool quit_{false};
+    int threads_{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+};
+
+// Pairwise sum of values[0, n) with a split that depends only on n, so the
+// result does not depend on how the values were produced.
+static inline double pairwise_sum(const double* values, long n) {
+    if (n <= 8) {
+        double s = 0.0;
+        for (long i = 0; i < n; i++) s += values[i];
+        return s;
+    }
+    long half = n / 2;
+    return pairwise_sum(values, half) + pairwise_sum(values + half, n - half);
+}
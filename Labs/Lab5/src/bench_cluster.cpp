@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/wait.h>
+#include "bench_nodes.h"
+#include "hash_ring.h"
+
+// Open-loop load on a whole cluster. Stands in for the controller (so it
+// needs its address free and ./computing next to it), builds a tree of
+// --depth levels under one root where every node above the last level has
+// --fanout children, spreads --keys keys over the nodes like control's
+// set/get (same hash ring, same ring keyspace) and preloads them with
+// MSET. Then it sends single-key requests at --rate per second for
+// --seconds, whatever the replies do: a fraction --finds of them are gets,
+// the rest sets, of keys drawn from a Zipf distribution with exponent
+// --zipf (0 is uniform).
+// Latency runs from when a request was due, not when it went out, so a
+// cluster that falls behind cannot hide it. Results are grouped by the
+// depth of the node that owns the key and go to cluster_bench.csv.
+// LAB5_TRANSPORT, LAB5_WORKERS and LAB5_DATA_DIR are passed on to the nodes.
+
+using Clock = std::chrono::steady_clock;
+
+const size_t BATCH = 4096;
+// Sends in a row before looking at replies again
+const int SEND_BURST = 64;
+// How long to wait for the last replies
+const std::chrono::seconds DRAIN(5);
+
+struct Options {
+    int depth{2};
+    int fanout{2};
+    int keys{100000};
+    double rate{20000};
+    double seconds{5};
+    double finds{0.9};
+    double zipf{0.99};
+};
+
+static Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        double value = std::atof(argv[i + 1]);
+        if (name == "--depth") options.depth = static_cast<int>(value);
+        else if (name == "--fanout") options.fanout = static_cast<int>(value);
+        else if (name == "--keys") options.keys = static_cast<int>(value);
+        else if (name == "--rate") options.rate = value;
+        else if (name == "--seconds") options.seconds = value;
+        else if (name == "--finds") options.finds = value;
+        else if (name == "--zipf") options.zipf = value;
+        else throw std::runtime_error("Unknown option " + name);
+    }
+    if ((argc - 1) % 2 != 0) {
+        throw std::runtime_error("Every option takes a value");
+    }
+    if (options.depth < 1 || options.fanout < 1 || options.keys < 1 || options.rate <= 0) {
+        throw std::runtime_error("depth, fanout, keys and rate must be positive");
+    }
+    return options;
+}
+
+// Key ranks by inverse CDF: rank r has weight 1 / (r + 1)^exponent
+class Zipf {
+public:
+    Zipf(int n, double exponent) : cdf_(n) {
+        double sum = 0;
+        for (int r = 0; r < n; r++) {
+            sum += 1.0 / std::pow(r + 1, exponent);
+            cdf_[r] = sum;
+        }
+        for (double& c : cdf_) {
+            c /= sum;
+        }
+    }
+
+    int operator()(uint64_t& state) const {
+        double u = (next_random(state) >> 11) * 0x1.0p-53;
+        return static_cast<int>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+// Nodes spawned by other nodes are not our children, so only the root is
+// waited for
+static void stop_cluster(const Child& root, const std::vector<pid_t>& pids) {
+    for (pid_t pid : pids) {
+        kill(pid, SIGTERM);
+    }
+    if (root.pid > 0) {
+        kill(root.pid, SIGTERM);
+        waitpid(root.pid, nullptr, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<pid_t> pids;
+    Child root;
+    try {
+        Options options = parse_options(argc, argv);
+        Node router = bind_router(-1);
+
+        // Node ids level by level; node 1 is the root
+        std::unordered_map<int, int> depth_of{{1, 1}};
+        root = create_process(1, router.address, 1);
+        pids.push_back(wait_reply(router).add_data);
+        std::vector<int> level{1};
+        int next_id = 2;
+        for (int depth = 2; depth <= options.depth; depth++) {
+            std::vector<int> below;
+            for (int parent : level) {
+                for (int i = 0; i < options.fanout; i++) {
+                    int id = next_id++;
+                    Message create(CommandType::Create, parent, id);
+                    create.request_id = id;
+                    zmq_lib::send_message(router, root, create);
+                    // The parent only routes to nodes that have announced
+                    pids.push_back(wait_reply(router).add_data);
+                    depth_of[id] = depth;
+                    below.push_back(id);
+                }
+            }
+            level = std::move(below);
+        }
+        std::cout << "Tree of " << options.depth << " levels, fan-out " << options.fanout << ": "
+                  << depth_of.size() << " nodes" << std::endl;
+
+        HashRing ring;
+        for (const auto& [id, depth] : depth_of) {
+            ring.add(id);
+        }
+        std::vector<std::string> keys(options.keys);
+        std::vector<int> owners(options.keys);
+        std::map<int, Message> loads;
+        int batches = 0;
+        for (int i = 0; i < options.keys; i++) {
+            keys[i] = "key" + std::to_string(i);
+            owners[i] = ring.owner(keys[i]);
+            auto [it, added] = loads.try_emplace(owners[i], CommandType::ExecMSet, owners[i], -1);
+            it->second.ring = true;
+            it->second.entries.push_back({keys[i], i, true});
+            if (it->second.entries.size() == BATCH) {
+                zmq_lib::send_message(router, root, it->second);
+                it->second.entries.clear();
+                batches++;
+            }
+        }
+        for (auto& [id, load] : loads) {
+            if (!load.entries.empty()) {
+                zmq_lib::send_message(router, root, load);
+                batches++;
+            }
+        }
+        for (int i = 0; i < batches; i++) {
+            wait_reply(router);
+        }
+
+        // Open loop: request i is due at start + i / rate
+        Zipf zipf(options.keys, options.zipf);
+        uint64_t state = 88172645463325252ULL;
+        long total = static_cast<long>(options.rate * options.seconds);
+        std::chrono::duration<double> interval(1.0 / options.rate);
+        struct InFlight {
+            Clock::time_point due;
+            int depth;
+        };
+        std::unordered_map<uint64_t, InFlight> in_flight;
+        std::map<int, std::vector<double>> latencies;
+        long errors = 0;
+
+        auto receive = [&] {
+            int sender;
+            while (true) {
+                Message reply = zmq_lib::receive_message(router, sender);
+                if (reply.command == CommandType::None) {
+                    return;
+                }
+                auto it = in_flight.find(reply.request_id);
+                if (it == in_flight.end()) {
+                    continue;
+                }
+                std::chrono::duration<double, std::micro> latency = Clock::now() - it->second.due;
+                latencies[it->second.depth].push_back(latency.count());
+                if (reply.command == CommandType::ExecErr) {
+                    errors++;
+                }
+                in_flight.erase(it);
+            }
+        };
+
+        Clock::time_point start = Clock::now();
+        zmq_pollitem_t item{router.socket, 0, ZMQ_POLLIN, 0};
+        long sent = 0;
+        while (sent < total) {
+            for (int burst = 0; burst < SEND_BURST && sent < total; burst++) {
+                Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(interval * sent);
+                if (due > Clock::now()) {
+                    break;
+                }
+                int rank = zipf(state);
+                int owner = owners[rank];
+                Message request = (next_random(state) >> 11) * 0x1.0p-53 < options.finds
+                    ? Message(CommandType::ExecFnd, owner, -1, keys[rank])
+                    : Message(CommandType::ExecAdd, owner, rank, keys[rank]);
+                request.request_id = static_cast<uint64_t>(sent) + 1;
+                request.ring = true;
+                zmq_lib::send_message(router, root, request);
+                in_flight[request.request_id] = {due, depth_of[owner]};
+                sent++;
+            }
+            receive();
+            Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(interval * sent);
+            // zmq_poll counts whole milliseconds, so the rest is slept off
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - Clock::now());
+            if (wait.count() > 0) {
+                zmq_poll(&item, 1, wait.count());
+            } else if (due > Clock::now()) {
+                std::this_thread::sleep_until(due);
+            }
+        }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        Clock::time_point give_up = Clock::now() + DRAIN;
+        while (!in_flight.empty() && Clock::now() < give_up) {
+            zmq_poll(&item, 1, 100);
+            receive();
+        }
+
+        std::ofstream csv("cluster_bench.csv");
+        csv << "depth,nodes,ops,ops_per_s,p50_us,p99_us,p999_us\n";
+        std::map<int, int> nodes_at;
+        for (const auto& [id, depth] : depth_of) {
+            nodes_at[depth]++;
+        }
+        std::vector<double> all;
+        auto report = [&](const std::string& depth, int nodes, std::vector<double>& sorted) {
+            if (sorted.empty()) {
+                return;
+            }
+            std::sort(sorted.begin(), sorted.end());
+            double ops = sorted.size() / elapsed.count();
+            std::cout << "depth " << depth << " (" << nodes << " nodes): " << static_cast<long>(ops)
+                      << " ops/s, p50 " << percentile(sorted, 0.5) << " us, p99 " << percentile(sorted, 0.99)
+                      << " us, p999 " << percentile(sorted, 0.999) << " us" << std::endl;
+            csv << depth << "," << nodes << "," << sorted.size() << "," << ops << "," << percentile(sorted, 0.5)
+                << "," << percentile(sorted, 0.99) << "," << percentile(sorted, 0.999) << "\n";
+        };
+        for (auto& [depth, values] : latencies) {
+            all.insert(all.end(), values.begin(), values.end());
+            report(std::to_string(depth), nodes_at[depth], values);
+        }
+        report("all", static_cast<int>(depth_of.size()), all);
+        std::cout << "Offered " << static_cast<long>(options.rate) << " ops/s, sent " << sent << " in "
+                  << elapsed.count() << " s, " << in_flight.size() << " unanswered, " << errors
+                  << " not found" << std::endl;
+        std::cout << "Results written to cluster_bench.csv\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        stop_cluster(root, pids);
+        return 1;
+    }
+    stop_cluster(root, pids);
+    return 0;
+}
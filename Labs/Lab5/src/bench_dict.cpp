@@ -0,0 +1,97 @@
+#include <chrono>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "flat_dict.h"
+
+// Node dictionary: std::map<std::string, int> against FlatDict.
+// For every size n, inserts keys "key:0" .. "key:n-1" in a scrambled order,
+// then looks up n random keys, a quarter of them absent. The map is looked
+// up the way the node used to, through a temporary std::string.
+// Usage: bench_dict [n ...], default 1000000 10000000. The map needs about
+// 80 bytes per key, so at 10^8 keys it takes several GB; pass --flat-only
+// to skip it. Results go to dict_bench.csv.
+
+struct KeyBuffer {
+    char data[32];
+
+    std::string_view make(uint64_t i) {
+        std::memcpy(data, "key:", 4);
+        char* end = std::to_chars(data + 4, data + sizeof(data), i).ptr;
+        return std::string_view(data, end - data);
+    }
+};
+
+// Visits 0 .. n-1 once each in a scrambled order, so neither table sees
+// sorted input; a permutation as long as n is not a multiple of the prime
+static uint64_t scramble(uint64_t i, uint64_t n) {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(i) * 2654435761ULL % n);
+}
+
+struct Result {
+    double insert_ns;
+    double lookup_ns;
+    uint64_t found;
+};
+
+template <typename Insert, typename Find>
+Result run(uint64_t n, Insert insert, Find find) {
+    KeyBuffer buffer;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        insert(buffer.make(scramble(i, n)), static_cast<int>(i));
+    }
+    std::chrono::duration<double, std::nano> inserting = std::chrono::steady_clock::now() - start;
+
+    uint64_t state = 88172645463325252ULL;
+    uint64_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        // Keys in [n, 4n / 3) are absent
+        found += find(buffer.make(next_random(state) % (n + n / 3)));
+    }
+    std::chrono::duration<double, std::nano> looking = std::chrono::steady_clock::now() - start;
+    return {inserting.count() / n, looking.count() / n, found};
+}
+
+int main(int argc, char* argv[]) {
+    bool with_map = true;
+    std::vector<uint64_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--flat-only") with_map = false;
+        else sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) sizes = {1000000, 10000000};
+
+    std::ofstream csv("dict_bench.csv");
+    csv << "table,keys,insert_ns,lookup_ns,bytes\n";
+    for (uint64_t n : sizes) {
+        if (with_map) {
+            std::map<std::string, int> map;
+            Result r = run(n,
+                [&](std::string_view key, int value) { map[std::string(key)] = value; },
+                [&](std::string_view key) { return map.find(std::string(key)) != map.end(); });
+            std::cout << "std::map  " << n << " keys: insert " << r.insert_ns << " ns, lookup "
+                      << r.lookup_ns << " ns (" << r.found << " found)\n";
+            csv << "map," << n << "," << r.insert_ns << "," << r.lookup_ns << ",\n";
+        }
+        {
+            FlatDict dict;
+            Result r = run(n,
+                [&](std::string_view key, int value) { dict[key] = value; },
+                [&](std::string_view key) { return dict.find(key) != nullptr; });
+            std::cout << "FlatDict  " << n << " keys: insert " << r.insert_ns << " ns, lookup "
+                      << r.lookup_ns << " ns (" << r.found << " found), "
+                      << dict.bytes() / n << " bytes per key\n";
+            csv << "flat," << n << "," << r.insert_ns << "," << r.lookup_ns << "," << dict.bytes() << "\n";
+        }
+    }
+    std::cout << "Results written to dict_bench.csv\n";
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include "bench_nodes.h"
+
+// Round-trip latency of tcp:// against ipc:// links between co-located nodes.
+// Stands in for the controller (so it needs its address free and ./computing
+// next to it), sets LAB5_TRANSPORT for each transport in turn and builds
+// the chain controller -> 1 -> 2, then sends PINGS pings one at a time to
+// node 1 (one link each way) and node 2 (two links each way).
+// Usage: bench_transport [transport ...], default tcp ipc.
+// Results go to transport_bench.csv.
+
+const int PINGS = 20000;
+const int WARMUP = 1000;
+
+// Sorted round trips in microseconds, one ping in flight at a time
+static std::vector<double> ping_latencies(Node& router, const Child& child, int id) {
+    std::vector<double> latencies;
+    latencies.reserve(PINGS);
+    for (int i = 0; i < WARMUP + PINGS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        zmq_lib::send_message(router, child, Message(CommandType::Ping, id, 0));
+        wait_reply(router);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (i >= WARMUP) {
+            latencies.push_back(elapsed.count());
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> transports;
+    for (int i = 1; i < argc; i++) {
+        transports.push_back(argv[i]);
+    }
+    if (transports.empty()) transports = {"tcp", "ipc"};
+
+    try {
+        std::ofstream csv("transport_bench.csv");
+        csv << "transport,hops,p50_us,p99_us,mean_us\n";
+        for (const std::string& transport : transports) {
+            setenv("LAB5_TRANSPORT", transport.c_str(), 1);
+            Node router = bind_router(-1);
+            Child child = create_process(1, router.address, 1);
+            wait_reply(router);
+            zmq_lib::send_message(router, child, Message(CommandType::Create, 1, 2));
+            pid_t grandchild = wait_reply(router).add_data;
+
+            for (int hops = 1; hops <= 2; hops++) {
+                std::vector<double> latencies = ping_latencies(router, child, hops);
+                double mean = 0;
+                for (double latency : latencies) {
+                    mean += latency;
+                }
+                mean /= latencies.size();
+                std::cout << transport << ", " << hops << " hop" << (hops > 1 ? "s" : "") << ": p50 "
+                          << percentile(latencies, 0.5) << " us, p99 " << percentile(latencies, 0.99)
+                          << " us, mean " << mean << " us" << std::endl;
+                csv << transport << "," << hops << "," << percentile(latencies, 0.5) << ","
+                    << percentile(latencies, 0.99) << "," << mean << "\n";
+            }
+
+            kill(grandchild, SIGTERM);
+            kill(child.pid, SIGTERM);
+            waitpid(child.pid, nullptr, 0);
+        }
+        std::cout << "Results written to transport_bench.csv\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include "bench_nodes.h"
+
+// Dictionary throughput of one computing node against its worker count.
+// Stands in for the controller (so it needs its address free and ./computing
+// next to it), starts a node with LAB5_WORKERS set to each count in turn,
+// preloads KEYS keys with MSET and then keeps WINDOW requests in flight:
+// first REQUESTS gets of random keys, then REQUESTS sets.
+// Usage: bench_workers [workers ...], default 1 2 4 8. LAB5_DATA_DIR is
+// passed on, so the sets include group-committed log writes if it is set.
+// Results go to workers_bench.csv.
+
+const int KEYS = 100000;
+const int REQUESTS = 200000;
+const int WINDOW = 512;
+const size_t BATCH = 4096;
+
+// Requests per second with WINDOW requests in flight
+template <typename MakeRequest>
+double pipelined(Node& router, const Child& child, MakeRequest make) {
+    auto start = std::chrono::steady_clock::now();
+    int sent = 0;
+    int received = 0;
+    while (received < REQUESTS) {
+        while (sent < REQUESTS && sent - received < WINDOW) {
+            zmq_lib::send_message(router, child, make());
+            sent++;
+        }
+        wait_reply(router);
+        received++;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return REQUESTS / elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(std::atoi(argv[i]));
+    }
+    if (counts.empty()) counts = {1, 2, 4, 8};
+
+    try {
+        Node router = bind_router(-1);
+        std::ofstream csv("workers_bench.csv");
+        csv << "workers,get_per_s,set_per_s\n";
+        for (int workers : counts) {
+            setenv("LAB5_WORKERS", std::to_string(workers).c_str(), 1);
+            Child child = create_process(1, router.address, 1);
+            wait_reply(router);
+
+            Message load(CommandType::ExecMSet, 1, -1);
+            int batches = 0;
+            for (int i = 0; i < KEYS; i++) {
+                load.entries.push_back({"key" + std::to_string(i), i, true});
+                if (load.entries.size() == BATCH || i == KEYS - 1) {
+                    zmq_lib::send_message(router, child, load);
+                    load.entries.clear();
+                    batches++;
+                }
+            }
+            for (int i = 0; i < batches; i++) {
+                wait_reply(router);
+            }
+
+            uint64_t state = 88172645463325252ULL;
+            double gets = pipelined(router, child, [&] {
+                return Message(CommandType::ExecFnd, 1, -1, "key" + std::to_string(next_random(state) % KEYS));
+            });
+            double sets = pipelined(router, child, [&] {
+                int i = static_cast<int>(next_random(state) % KEYS);
+                return Message(CommandType::ExecAdd, 1, i, "key" + std::to_string(i));
+            });
+            std::cout << workers << " workers: " << static_cast<long>(gets) << " gets/s, "
+                      << static_cast<long>(sets) << " sets/s" << std::endl;
+            csv << workers << "," << gets << "," << sets << "\n";
+
+            kill(child.pid, SIGTERM);
+            waitpid(child.pid, nullptr, 0);
+        }
+        std::cout << "Results written to workers_bench.csv\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,13 +1,15 @@
 #include "nodes.h"
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <node_id>" << std::endl;
+    if (argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " <node_id> <parent_endpoint> <request_id> <heartbeat_ms>"
+                  << std::endl;
         return 1;
     }
 
     try {
-        ComputingNode node(std::atoi(argv[1]));
+        ComputingNode node(std::atoi(argv[1]), argv[2], std::strtoull(argv[3], nullptr, 10),
+                           std::strtoull(argv[4], nullptr, 10));
         node.run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
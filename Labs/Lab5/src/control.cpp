@@ -1,58 +1,200 @@
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
 #include "unordered_set"
+#include "hash_ring.h"
+#include "timer_wheel.h"
 #include "zmq_operations.h"
 
+// Requests without an answer after this long are reported as unavailable
+constexpr std::chrono::seconds PENDING_TIMEOUT(5);
+// Timeout resolution; 256 slots of 50 ms cover PENDING_TIMEOUT in one round
+constexpr std::chrono::milliseconds TIMER_TICK(50);
+constexpr size_t TIMER_SLOTS = 256;
+// Keys per MSET message when loading a file
+constexpr size_t LOAD_BATCH = 4096;
+// MSET batches a migration keeps in flight, so each one gets the whole
+// PENDING_TIMEOUT instead of sharing it with the rest of the copy
+constexpr size_t MIGRATION_WINDOW = 4;
+// A failed join is retried after MIGRATION_BACKOFF, doubling every time
+constexpr int MIGRATION_ATTEMPTS = 4;
+constexpr std::chrono::seconds MIGRATION_BACKOFF(1);
+
+// A node joining the ring. Its arcs keep going to their old owners until
+// every old owner has answered the Scan and the new node has acknowledged
+// every MSET batch of their keys. set commands for those arcs meanwhile
+// are also kept in dirty and copied in further rounds until a round leaves
+// nothing dirty; then the ring switches over and the old owners drop what
+// they gave away. If any of these requests times out, the migration is
+// abandoned: the old owners keep their keys, the new node drops its partial
+// copy and the join is retried later.
+struct Migration {
+    int target{-1};
+    int attempt{0};
+    HashRing next;
+    std::map<int, std::vector<KeyRange>> sources;
+    // Scan and MSET requests not answered yet
+    std::unordered_set<uint64_t> requests;
+    // MSET batches waiting for room in MIGRATION_WINDOW
+    std::deque<Message> batches;
+    size_t copying{0};
+    size_t keys{0};
+    std::unordered_map<std::string, int> dirty;
+};
+
 class Controller {
 private:
     std::unordered_set<int> node_ids_;
-    std::list<Message> pending_messages_;
-    std::list<Node> children_;
+    // Ids of create requests still waiting for the node to announce itself.
+    // Commands after a create wait until it is answered or times out, so
+    // that they can name the new node as a parent or target and a
+    // heartbeat interval reaches it.
+    std::unordered_set<int> creating_;
+    // Outstanding requests by request id; nodes echo the id in replies
+    std::unordered_map<uint64_t, Message> pending_;
+    TimerWheel timeouts_{TIMER_TICK, TIMER_SLOTS};
+    uint64_t next_request_id_{1};
+    std::vector<uint64_t> expired_;
+    // All children connect to this one ROUTER
+    Node router_{bind_router(-1)};
+    std::list<Child> children_;
+    // Every node id -> the direct child whose subtree holds it
+    std::unordered_map<int, Child*> routes_;
     std::chrono::milliseconds heartbeat = std::chrono::milliseconds::zero();
+    // Last beat of every node that has beaten at least once; a node is only
+    // watched from its first beat on
     std::map<int, std::chrono::system_clock::time_point> beat_tracker;
+    LineReader input_{STDIN_FILENO};
+    bool stdin_open_{true};
+    // Owners of keys for set/get; every node joins once it is created
+    HashRing ring_;
+    std::optional<Migration> migration_;
+    // Nodes waiting to join the ring: created while a migration was
+    // running, or retrying a failed one once due
+    struct Join {
+        int id;
+        int attempt;
+        std::chrono::system_clock::time_point due;
+    };
+    std::deque<Join> joins_;
+    // Migration and replication requests, handled here instead of printed
+    std::unordered_set<uint64_t> internal_;
+    // Copies of every set kept on the next nodes clockwise on the ring
+    size_t replicas_{0};
+    // Writes for each replica, sent as one MSET per loop iteration
+    std::map<int, Message> replication_;
+    // Nodes that missed their beats; reads and replica writes avoid them
+    std::unordered_set<int> down_;
+    // Replicas that let a write batch time out, reported once until they
+    // acknowledge one again
+    std::unordered_set<int> lagging_;
+    // get requests served by a replica, retried on the owner on a miss
+    std::unordered_set<uint64_t> replica_reads_;
+    uint64_t next_read_{0};
+
+    void handle_child_message(const Message& message, Child& child) {
+        if (message.command == CommandType::HeartBeat) {
+            std::cout << "Ok: " << message.id << " Got beat" << std::endl;
+            beat_tracker[message.id] = now();
+            down_.erase(message.id);
+            return;
+        }
+        if (message.command == CommandType::Create) {
+            // The node exists even if its announcement comes after the timeout
+            creating_.erase(message.id);
+            bool added = node_ids_.insert(message.id).second;
+            routes_[message.id] = &child;
+            if (added) {
+                join_ring(message.id);
+            }
+        }
 
-    void handle_child_message(const Message& message) {
+        // Replies to requests that already timed out are dropped
+        if (pending_.erase(message.request_id) == 0) {
+            return;
+        }
+        if (internal_.erase(message.request_id)) {
+            if (migration_ && migration_->requests.erase(message.request_id)) {
+                handle_migration_reply(message);
+            } else if (message.command == CommandType::ExecMSet) {
+                lagging_.erase(message.id);
+            }
+            return;
+        }
+        if (replica_reads_.erase(message.request_id) && message.command == CommandType::ExecErr &&
+            !message.key.empty()) {
+            // The replica may not have caught up, or may have only joined
+            // after the key was written; the owner has the answer
+            int owner = ring_.owner(message.key);
+            if (owner != message.id) {
+                send_to_node(ring_message(CommandType::ExecFnd, owner, -1, message.key));
+                return;
+            }
+        }
         switch (message.command) {
             case CommandType::Create:
-                node_ids_.insert(message.id);
-                beat_tracker[message.id] = now();
                 std::cout << "Ok: " << message.add_data << std::endl;
-                remove_pending_message(CommandType::Create, message.id);
                 break;
 
             case CommandType::Ping:
                 std::cout << "Ok: " << message.id << " is available" << std::endl;
-                remove_pending_message(CommandType::Ping, message.id);
                 break;
 
             case CommandType::ExecErr:
-                std::cout << "Ok: " << message.id << " '" << message.val << "' not found" << std::endl;
-                remove_pending_message(CommandType::ExecFnd, message.id);
+                if (message.key.empty()) {
+                    // A request the node's workers had no room for
+                    std::cout << "Error: Node " << message.id << " is overloaded" << std::endl;
+                } else {
+                    std::cout << "Ok: " << message.id << " '" << message.key << "' not found" << std::endl;
+                }
                 break;
 
             case CommandType::ExecAdd:
                 std::cout << "Ok: " << message.id << std::endl;
-                remove_pending_message(CommandType::ExecAdd, message.id);
                 break;
 
             case CommandType::ExecFnd:
-                std::cout << "Ok: " << message.id << " '" << message.val << "' " << message.add_data << std::endl;
-                remove_pending_message(CommandType::ExecFnd, message.id);
+                std::cout << "Ok: " << message.id << " '" << message.key << "' " << message.add_data << std::endl;
+                break;
+
+            case CommandType::ExecMSet:
+                std::cout << "Ok: " << message.id << " " << message.add_data << " keys set" << std::endl;
+                break;
+
+            case CommandType::ExecMGet:
+                for (const KeyValue& entry : message.entries) {
+                    if (entry.found) {
+                        std::cout << "Ok: " << message.id << " '" << entry.key << "' " << entry.value << "\n";
+                    } else {
+                        std::cout << "Ok: " << message.id << " '" << entry.key << "' not found\n";
+                    }
+                }
+                std::cout.flush();
+                break;
+
+            default:
                 break;
-            case CommandType::HeartBeat:
-                std::cout << "Ok: " << message.id << " Got beat" << std::endl;
-                beat_tracker[message.id] = now();
         }
     }
 
     void check_pending_messages() {
-        auto now_time = now();
-        auto it = pending_messages_.begin();
-        while (it != pending_messages_.end()) {
-            if (std::chrono::duration_cast<std::chrono::seconds>(
-                    now_time - it->sent_time).count() > 5) {
-                handle_timeout(*it);
-                it = pending_messages_.erase(it);
-            } else {
-                ++it;
+        expired_.clear();
+        timeouts_.expire(now(), expired_);
+        for (uint64_t request_id : expired_) {
+            auto it = pending_.find(request_id);
+            if (it != pending_.end()) {
+                Message message = std::move(it->second);
+                pending_.erase(it);
+                replica_reads_.erase(request_id);
+                if (internal_.erase(request_id)) {
+                    handle_internal_timeout(message, request_id);
+                } else {
+                    handle_timeout(message);
+                }
             }
         }
     }
@@ -63,38 +205,236 @@ private:
                 std::cout << "Error: Ok " << message.id << " is unavailable" << std::endl;
                 break;
             case CommandType::Create:
+                creating_.erase(message.add_data);
                 std::cout << "Error: Parent " << message.id << " is unavailable" << std::endl;
                 break;
             case CommandType::ExecAdd:
             case CommandType::ExecFnd:
+            case CommandType::ExecMSet:
+            case CommandType::ExecMGet:
+            case CommandType::Scan:
+            case CommandType::Drop:
                 std::cout << "Error: Node " << message.id << " is unavailable" << std::endl;
                 break;
         }
     }
 
-    void remove_pending_message(CommandType cmd, int id) {
-        auto it = std::find_if(pending_messages_.begin(), pending_messages_.end(),
-            [cmd, id](const Message& m) {
-                return (m.command == cmd && m.id == id) ||
-                    (m.command == cmd && m.command == CommandType::Create && m.add_data == id);
-            });
-        if (it != pending_messages_.end()) {
-            pending_messages_.erase(it);
+    // Nobody typed these, so "Node X is unavailable" would be noise
+    void handle_internal_timeout(const Message& message, uint64_t request_id) {
+        if (migration_ && migration_->requests.count(request_id)) {
+            abort_migration();
+        } else if (message.command == CommandType::ExecMSet && lagging_.insert(message.id).second) {
+            std::cout << "Error: Replica " << message.id << " is not answering, its copies may be stale"
+                      << std::endl;
         }
+        // A lost Drop only leaves keys the old owner no longer serves
     }
 
-    void broadcast_message(const Message& message) {
-        pending_messages_.push_back(message);
-        for (auto& child : children_) {
-            zmq_lib::send_message(child, message);
+    // Tags the request with a fresh id and starts its timeout. Batch
+    // entries are not kept, a timeout only reports the node.
+    uint64_t add_pending(const Message& message) {
+        Message pending(message.command, message.id, message.add_data, message.key);
+        pending.sent_time = message.sent_time;
+        pending.request_id = next_request_id_++;
+        timeouts_.schedule(pending.request_id, pending.sent_time + PENDING_TIMEOUT);
+        return pending_.emplace(pending.request_id, std::move(pending)).first->first;
+    }
+
+    // Sends the request down the one subtree that holds message.id
+    uint64_t send_to_node(Message message) {
+        message.request_id = add_pending(message);
+        auto it = routes_.find(message.id);
+        if (it != routes_.end()) {
+            zmq_lib::send_message(router_, *it->second, message);
+        }
+        return message.request_id;
+    }
+
+    uint64_t send_internal(Message message) {
+        uint64_t request_id = send_to_node(std::move(message));
+        internal_.insert(request_id);
+        return request_id;
+    }
+
+    // set/get and everything that moves their keys work on the ring
+    // keyspace of a node, never on the keys exec/mset/load gave it
+    static Message ring_message(CommandType command, int id, int add_data, const std::string& key = "") {
+        Message message(command, id, add_data, key);
+        message.ring = true;
+        return message;
+    }
+
+    // Queues ring entries for the joining node as MSET batches of
+    // LOAD_BATCH keys; the migration waits for each of them
+    void queue_migration_batches(const std::vector<KeyValue>& entries) {
+        for (size_t first = 0; first < entries.size(); first += LOAD_BATCH) {
+            Message batch = ring_message(CommandType::ExecMSet, migration_->target, -1);
+            size_t last = std::min(entries.size(), first + LOAD_BATCH);
+            batch.entries.assign(entries.begin() + first, entries.begin() + last);
+            migration_->batches.push_back(std::move(batch));
+        }
+        send_migration_batches();
+    }
+
+    // Tops the batches in flight up to MIGRATION_WINDOW
+    void send_migration_batches() {
+        while (migration_->copying < MIGRATION_WINDOW && !migration_->batches.empty()) {
+            Message batch = std::move(migration_->batches.front());
+            migration_->batches.pop_front();
+            batch.sent_time = now();
+            migration_->requests.insert(send_internal(std::move(batch)));
+            migration_->copying++;
+        }
+    }
+
+    // Queues a write for a replica; flushed by flush_replication()
+    void replicate(int id, const std::string& key, int val) {
+        auto it = replication_.try_emplace(id, ring_message(CommandType::ExecMSet, id, -1)).first;
+        it->second.entries.push_back({key, val, true});
+        if (it->second.entries.size() >= LOAD_BATCH) {
+            it->second.sent_time = now();
+            send_internal(std::move(it->second));
+            replication_.erase(it);
+        }
+    }
+
+    // Replicas are written asynchronously: nobody waits for their acks,
+    // and writes made in one loop iteration share one message per replica
+    void flush_replication() {
+        for (auto& [id, batch] : replication_) {
+            batch.sent_time = now();
+            send_internal(std::move(batch));
         }
+        replication_.clear();
     }
 
-    void handle_create_command() {
+    void join_ring(int id) {
+        if (ring_.empty()) {
+            ring_.add(id);
+        } else {
+            joins_.push_back({id, 0, now()});
+            start_join();
+        }
+    }
+
+    // Starts the first join that is due unless a migration is running
+    void start_join() {
+        if (migration_) {
+            return;
+        }
+        auto due = std::find_if(joins_.begin(), joins_.end(),
+                                [now = now()](const Join& join) { return join.due <= now; });
+        if (due != joins_.end()) {
+            Join join = *due;
+            joins_.erase(due);
+            start_migration(join.id, join.attempt);
+        }
+    }
+
+    // Asks every node that loses arcs to the new one for their keys
+    void start_migration(int id, int attempt) {
+        migration_.emplace();
+        migration_->target = id;
+        migration_->attempt = attempt;
+        migration_->next = ring_;
+        migration_->next.add(id);
+        migration_->sources = ring_.ranges_moving_to(id);
+        for (const auto& [source, ranges] : migration_->sources) {
+            Message scan(CommandType::Scan, source, -1);
+            scan.ranges = ranges;
+            migration_->requests.insert(send_internal(std::move(scan)));
+        }
+        advance_migration();
+    }
+
+    // A Scan reply carries keys to copy, an MSET reply confirms a copy.
+    // ExecErr means a node was too busy to take the request at all.
+    void handle_migration_reply(const Message& message) {
+        if (message.command == CommandType::ExecErr) {
+            abort_migration();
+            return;
+        }
+        if (message.command == CommandType::Scan) {
+            migration_->keys += message.entries.size();
+            queue_migration_batches(message.entries);
+        } else {
+            migration_->copying--;
+            send_migration_batches();
+        }
+        advance_migration();
+    }
+
+    // Once everything sent so far is confirmed, copies the writes made
+    // meanwhile, or finishes if there were none
+    void advance_migration() {
+        if (!migration_->requests.empty() || !migration_->batches.empty()) {
+            return;
+        }
+        if (!migration_->dirty.empty()) {
+            std::vector<KeyValue> dirty;
+            for (auto& [key, value] : migration_->dirty) {
+                dirty.push_back({key, value, true});
+            }
+            migration_->dirty.clear();
+            queue_migration_batches(dirty);
+            return;
+        }
+        finish_migration();
+    }
+
+    // The new node has all its keys: switch the ring and let the old
+    // owners drop what they gave away
+    void finish_migration() {
+        ring_ = migration_->next;
+        for (const auto& [source, ranges] : migration_->sources) {
+            Message drop(CommandType::Drop, source, -1);
+            drop.ranges = ranges;
+            send_internal(std::move(drop));
+        }
+        if (migration_->keys > 0) {
+            std::cout << "Ok: " << migration_->target << " took over " << migration_->keys
+                      << " keys" << std::endl;
+        }
+        next_migration();
+    }
+
+    // A Scan or a copy was lost, so the old owners keep their keys and the
+    // new node drops what it got so far; the join is tried again after a
+    // backoff until MIGRATION_ATTEMPTS have failed
+    void abort_migration() {
+        for (uint64_t request_id : migration_->requests) {
+            pending_.erase(request_id);
+            internal_.erase(request_id);
+        }
+        Message drop = ring_message(CommandType::Drop, migration_->target, -1);
+        for (const auto& [source, ranges] : migration_->sources) {
+            drop.ranges.insert(drop.ranges.end(), ranges.begin(), ranges.end());
+        }
+        send_internal(std::move(drop));
+
+        int attempt = migration_->attempt + 1;
+        if (attempt < MIGRATION_ATTEMPTS) {
+            auto backoff = MIGRATION_BACKOFF * (1 << (attempt - 1));
+            std::cout << "Error: Node " << migration_->target << " could not take over its keys, retrying in "
+                      << backoff.count() << " s" << std::endl;
+            joins_.push_back({migration_->target, attempt, now() + backoff});
+        } else {
+            std::cout << "Error: Node " << migration_->target
+                      << " could not take over its keys and stays off the ring" << std::endl;
+        }
+        next_migration();
+    }
+
+    void next_migration() {
+        migration_.reset();
+        start_join();
+    }
+
+    void handle_create_command(std::istream& args) {
         int parent_id, child_id;
-        std::cin >> child_id >> parent_id;
+        args >> child_id >> parent_id;
 
-        if (node_ids_.count(child_id)) {
+        if (node_ids_.count(child_id) || creating_.count(child_id)) {
             std::cout << "Error: Node with id " << child_id << " already exists" << std::endl;
             return;
         }
@@ -104,53 +444,196 @@ private:
             return;
         }
 
+        creating_.insert(child_id);
         if (parent_id == -1) {
-            Node child = create_process(child_id);
-            children_.push_back(std::move(child));
-            node_ids_.insert(child_id);
-            std::cout << "Ok: " << child.pid << std::endl;
+            // "Ok: pid" is printed once the child connects and announces
+            // itself with this request id
+            uint64_t request_id = add_pending(Message(CommandType::Create, parent_id, child_id));
+            children_.push_back(create_process(child_id, router_.address, request_id, heartbeat.count()));
+            routes_[child_id] = &children_.back();
         } else {
-            broadcast_message(Message(CommandType::Create, parent_id, child_id));
+            // The new node starts beating at the current interval
+            Message create(CommandType::Create, parent_id, child_id);
+            create.interval = heartbeat.count();
+            send_to_node(std::move(create));
         }
     }
 
-    void handle_exec_command() {
-        char input[100];
-        fgets(input, sizeof(input), stdin);
-
+    void handle_exec_command(std::istream& args) {
         int id, val;
-        char key[30];
+        std::string key;
+        if (!(args >> id >> key)) {
+            return;
+        }
 
-        if (sscanf(input, "%d %30s %d", &id, key, &val) == 3) {
+        if (args >> val) {
             if (!node_ids_.count(id)) {
                 std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
                 return;
             }
-            broadcast_message(Message(CommandType::ExecAdd, id, val, key));
+            send_to_node(Message(CommandType::ExecAdd, id, val, key));
         }
-        else if (sscanf(input, "%d %30s", &id, key) == 2) {
+        else {
             if (!node_ids_.count(id)) {
                 std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
                 return;
             }
-            broadcast_message(Message(CommandType::ExecFnd, id, -1, key));
+            send_to_node(Message(CommandType::ExecFnd, id, -1, key));
+        }
+    }
+
+    // mset id key val [key val ...]
+    void handle_mset_command(std::istream& args) {
+        int id;
+        if (!(args >> id)) {
+            return;
+        }
+        Message message(CommandType::ExecMSet, id, -1);
+        KeyValue entry;
+        entry.found = true;
+        while (args >> entry.key >> entry.value) {
+            message.entries.push_back(entry);
+        }
+        if (!node_ids_.count(id)) {
+            std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
+            return;
+        }
+        if (!message.entries.empty()) {
+            send_to_node(std::move(message));
+        }
+    }
+
+    // mget id key [key ...]
+    void handle_mget_command(std::istream& args) {
+        int id;
+        if (!(args >> id)) {
+            return;
+        }
+        Message message(CommandType::ExecMGet, id, -1);
+        KeyValue entry;
+        while (args >> entry.key) {
+            message.entries.push_back(entry);
+        }
+        if (!node_ids_.count(id)) {
+            std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
+            return;
+        }
+        if (!message.entries.empty()) {
+            send_to_node(std::move(message));
+        }
+    }
+
+    // load id path: "key value" pairs from a file, sent as MSET batches of
+    // LOAD_BATCH keys; every batch reports separately
+    void handle_load_command(std::istream& args) {
+        int id;
+        std::string path;
+        args >> id >> path;
+        if (!node_ids_.count(id)) {
+            std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
+            return;
+        }
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "Error: Cannot open " << path << std::endl;
+            return;
+        }
+
+        Message message(CommandType::ExecMSet, id, -1);
+        message.entries.reserve(LOAD_BATCH);
+        KeyValue entry;
+        entry.found = true;
+        while (file >> entry.key >> entry.value) {
+            message.entries.push_back(entry);
+            if (message.entries.size() == LOAD_BATCH) {
+                message.sent_time = now();
+                send_to_node(message);
+                message.entries.clear();
+            }
+        }
+        if (!file.eof()) {
+            std::cout << "Error: Bad value for key '" << entry.key << "' in " << path << std::endl;
+        }
+        if (!message.entries.empty()) {
+            message.sent_time = now();
+            send_to_node(std::move(message));
+        }
+    }
+
+    // set key val, on the node that owns key on the ring
+    void handle_set_command(std::istream& args) {
+        std::string key;
+        int val;
+        if (!(args >> key >> val)) {
+            return;
+        }
+        int owner = ring_.owner(key);
+        if (owner == -1) {
+            std::cout << "Error: No computing nodes" << std::endl;
+            return;
+        }
+        if (migration_ && migration_->next.owner(key) == migration_->target) {
+            migration_->dirty[key] = val;
+        }
+        send_to_node(ring_message(CommandType::ExecAdd, owner, val, key));
+        if (replicas_ > 0) {
+            std::vector<int> nodes = ring_.owners(key, replicas_ + 1);
+            for (size_t i = 1; i < nodes.size(); i++) {
+                if (!down_.count(nodes[i])) {
+                    replicate(nodes[i], key, val);
+                }
+            }
         }
     }
 
-    void handle_ping_command() {
+    // get key, from the node that owns key on the ring
+    void handle_get_command(std::istream& args) {
+        std::string key;
+        if (!(args >> key)) {
+            return;
+        }
+        std::vector<int> nodes = ring_.owners(key, replicas_ + 1);
+        if (nodes.empty()) {
+            std::cout << "Error: No computing nodes" << std::endl;
+            return;
+        }
+        // Round robin over the owner and its replicas that still beat
+        std::vector<int> alive;
+        for (int node : nodes) {
+            if (!down_.count(node)) alive.push_back(node);
+        }
+        int target = alive.empty() ? nodes[0] : alive[next_read_++ % alive.size()];
+        uint64_t request_id = send_to_node(ring_message(CommandType::ExecFnd, target, -1, key));
+        if (target != nodes[0]) {
+            replica_reads_.insert(request_id);
+        }
+    }
+
+    // replicas n: later set commands also go to the next n nodes
+    void handle_replicas_command(std::istream& args) {
+        int count;
+        if (!(args >> count) || count < 0) {
+            std::cout << "Error: Bad replica count" << std::endl;
+            return;
+        }
+        replicas_ = count;
+        std::cout << "Ok: " << count << " replicas" << std::endl;
+    }
+
+    void handle_ping_command(std::istream& args) {
         int id;
-        std::cin >> id;
+        args >> id;
         if (!node_ids_.count(id)) {
             std::cout << "Error: Node with id " << id << " doesn't exist" << std::endl;
         } else {
-            broadcast_message(Message(CommandType::Ping, id, 0));
+            send_to_node(Message(CommandType::Ping, id, 0));
         }
     }
 
-    void handle_heartbeat_command()
+    void handle_heartbeat_command(std::istream& args)
     {
         int time;
-        std::cin >> time;
+        args >> time;
         heartbeat = std::chrono::milliseconds(time);
         for (auto& [key, value] : beat_tracker)
         {
@@ -159,8 +642,26 @@ private:
 
         auto msg = Message(CommandType::HeartBeat, -1, time);
         for (auto& child : children_) {
-            zmq_lib::send_message(child, msg);
+            zmq_lib::send_message(router_, child, msg);
+        }
+    }
+
+    // Earliest moment a pending request can time out, a failed join can be
+    // retried or a node can miss its beats; the event loop sleeps until
+    // then unless something arrives.
+    std::chrono::system_clock::time_point next_deadline() const {
+        auto deadline = timeouts_.next_deadline();
+        if (!migration_) {
+            for (const Join& join : joins_) {
+                deadline = std::min(deadline, join.due);
+            }
         }
+        if (heartbeat > std::chrono::milliseconds::zero()) {
+            for (const auto& [key, value] : beat_tracker) {
+                deadline = std::min(deadline, value + 4 * heartbeat);
+            }
+        }
+        return deadline;
     }
 
     void check_beats() {
@@ -169,6 +670,7 @@ private:
                     now() - value).count() > 4 * heartbeat.count())
             {
                 std::cout << "Node: " << key << " has no beat!" << std::endl;
+                down_.insert(key);
                 value = now();
             }
         }
@@ -179,44 +681,96 @@ public:
         node_ids_.insert(-1);
     }
 
-    void run() {
+    void handle_command(const std::string& line) {
+        std::istringstream args(line);
         std::string command;
+        if (!(args >> command)) {
+            return;
+        }
+        if (command == "create") {
+            handle_create_command(args);
+        }
+        else if (command == "exec") {
+            handle_exec_command(args);
+        }
+        else if (command == "set") {
+            handle_set_command(args);
+        }
+        else if (command == "get") {
+            handle_get_command(args);
+        }
+        else if (command == "replicas") {
+            handle_replicas_command(args);
+        }
+        else if (command == "mset") {
+            handle_mset_command(args);
+        }
+        else if (command == "mget") {
+            handle_mget_command(args);
+        }
+        else if (command == "load") {
+            handle_load_command(args);
+        }
+        else if (command == "ping") {
+            handle_ping_command(args);
+        }
+        else if (command == "heartbeat")
+        {
+            handle_heartbeat_command(args);
+        }
+        else {
+            std::cout << "Error: Command doesn't exist!" << std::endl;
+        }
+    }
+
+    void run() {
+        std::vector<zmq_pollitem_t> items;
         while (true) {
+            // Sleep until a child or stdin has input, or the next deadline
+            items.clear();
+            items.push_back({router_.socket, 0, ZMQ_POLLIN, 0});
+            if (stdin_open_) {
+                items.push_back({nullptr, STDIN_FILENO, ZMQ_POLLIN, 0});
+            }
+            bool ready = creating_.empty() && input_.has_line();
+            long timeout = ready ? 0 : poll_timeout(next_deadline());
+
+            if (zmq_poll(items.data(), static_cast<int>(items.size()), timeout) < 0) {
+                if (zmq_errno() == EINTR) continue;
+                throw std::runtime_error("zmq_poll failed: " + std::string(zmq_strerror(zmq_errno())));
+            }
+
             // Handle messages from children
-            for (auto& child : children_) {
-                Message message = zmq_lib::receive_message(child);
-                if (message.command != CommandType::None) {
-                    handle_child_message(message);
+            if (items[0].revents & ZMQ_POLLIN) {
+                Message message;
+                int sender;
+                while ((message = zmq_lib::receive_message(router_, sender)).command != CommandType::None) {
+                    auto child = routes_.find(sender);
+                    if (child != routes_.end()) {
+                        handle_child_message(message, *child->second);
+                    }
                 }
             }
 
             check_pending_messages();
+            start_join();
 
             if (heartbeat > std::chrono::milliseconds::zero()) {
                 check_beats();
             }
 
-            if (!input_available()) {
-                continue;
-            }
-
-            std::cin >> command;
-            if (command == "create") {
-                handle_create_command();
-            }
-            else if (command == "exec") {
-                handle_exec_command();
-            }
-            else if (command == "ping") {
-                handle_ping_command();
-            }
-            else if (command == "heartbeat")
-            {
-                handle_heartbeat_command();
+            // A closed pipe only raises POLLHUP, which zmq_poll reports as
+            // POLLERR; reading is what notices the EOF and drops stdin, but
+            // replies are still served after that
+            if (stdin_open_ && (items.back().revents & (ZMQ_POLLIN | ZMQ_POLLERR))) {
+                stdin_open_ = input_.fill();
             }
-            else {
-                std::cout << "Error: Command doesn't exist!" << std::endl;
+            // One command per pass, so replies keep flowing during a long script
+            std::string line;
+            if (creating_.empty() && input_.next_line(line)) {
+                handle_command(line);
             }
+            flush_replication();
         }
     }
 };
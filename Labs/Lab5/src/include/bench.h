@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Helpers shared by the bench_* programs; the ones that talk to nodes are
+// in bench_nodes.h, so bench_dict builds without zmq
+
+// xorshift64; state must not be 0
+inline uint64_t next_random(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// p in [0, 1] of an ascending sample
+inline double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdexcept>
+#include "bench.h"
+#include "zmq_operations.h"
+
+// Helpers for the bench_* programs that stand in for the controller
+
+// Next message from any child; a node that stays silent for 5 s is an error
+inline Message wait_reply(Node& router) {
+    zmq_pollitem_t item{router.socket, 0, ZMQ_POLLIN, 0};
+    while (true) {
+        int sender;
+        Message message = zmq_lib::receive_message(router, sender);
+        if (message.command != CommandType::None) {
+            return message;
+        }
+        if (zmq_poll(&item, 1, 5000) == 0) {
+            throw std::runtime_error("node does not answer");
+        }
+    }
+}
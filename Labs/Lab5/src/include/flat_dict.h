@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Open-addressing string -> int table in the Swiss table layout. Slots come
+// in groups of FLAT_DICT_GROUP, and every slot has a control byte that is
+// either FLAT_DICT_EMPTY or the low 7 bits of its key's hash. A probe tests
+// a whole group with a few word operations and compares only the keys whose
+// tag matches. Key bytes are packed into one arena and slots keep offsets
+// into it, so the table is three flat arrays and lookups by string_view
+// never allocate. Erased slots become FLAT_DICT_DELETED tombstones, which
+// keep probe chains intact until the next rehash clears them.
+
+#define FLAT_DICT_GROUP 8
+#define FLAT_DICT_EMPTY 0x80
+#define FLAT_DICT_DELETED 0xFE
+// Grow once more than 7/8 of the slots are full
+#define FLAT_DICT_LOAD_NUM 7
+#define FLAT_DICT_LOAD_DEN 8
+
+class FlatDict {
+public:
+    FlatDict() { rehash(1); }
+
+    size_t size() const { return size_; }
+
+    // Control bytes, slots and key arena
+    size_t bytes() const {
+        return ctrl_.capacity() + slots_.capacity() * sizeof(Slot) + arena_.capacity();
+    }
+
+    void reserve(size_t count) {
+        size_t groups = groups_;
+        while (max_size(groups) < count) groups *= 2;
+        if (groups != groups_) rehash(groups);
+    }
+
+    // Calls f(std::string_view key, int value) for every entry, in no order
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < ctrl_.size(); i++) {
+            if (ctrl_[i] & 0x80) continue;
+            f(std::string_view(arena_.data() + slots_[i].offset, slots_[i].length), slots_[i].value);
+        }
+    }
+
+    // nullptr if the key is absent
+    const int* find(std::string_view key) const {
+        bool found;
+        size_t i = locate(key, hash_key(key), found);
+        return found ? &slots_[i].value : nullptr;
+    }
+
+    // Inserts 0 for a new key
+    int& operator[](std::string_view key) {
+        if (size_ + deleted_ >= max_size(groups_)) {
+            // Mostly tombstones: clean up in place instead of growing
+            rehash(size_ >= max_size(groups_) / 2 ? groups_ * 2 : groups_);
+        }
+        uint64_t hash = hash_key(key);
+        bool found;
+        size_t i = locate(key, hash, found);
+        if (!found) {
+            ctrl_[i] = static_cast<uint8_t>(hash & 0x7f);
+            slots_[i] = {arena_.size(), static_cast<uint32_t>(key.size()), 0};
+            arena_.insert(arena_.end(), key.begin(), key.end());
+            size_++;
+        }
+        return slots_[i].value;
+    }
+
+    // Returns false if the key was absent
+    bool erase(std::string_view key) {
+        bool found;
+        size_t i = locate(key, hash_key(key), found);
+        if (!found) return false;
+        ctrl_[i] = FLAT_DICT_DELETED;
+        dead_bytes_ += slots_[i].length;
+        size_--;
+        deleted_++;
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint64_t offset;
+        uint32_t length;
+        int value;
+    };
+
+    static constexpr uint64_t LOW_BITS = 0x0101010101010101ULL;
+    static constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+    static size_t max_size(size_t groups) {
+        return groups * FLAT_DICT_GROUP * FLAT_DICT_LOAD_NUM / FLAT_DICT_LOAD_DEN;
+    }
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t hash_key(std::string_view key) {
+        uint64_t h = 0x9E3779B97F4A7C15ULL ^ key.size();
+        size_t i = 0;
+        for (; i + 8 <= key.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, key.data() + i, sizeof(word));
+            h = mix(h ^ word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, key.data() + i, key.size() - i);
+        return mix(h ^ tail);
+    }
+
+    // Control bytes of a group, slot j of the group in byte j
+    uint64_t load_group(size_t group) const {
+        uint64_t word;
+        std::memcpy(&word, &ctrl_[group * FLAT_DICT_GROUP], sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
+    // High bit set in the empty bytes: 0x80 has bit 1 clear, 0xFE has it set
+    static uint64_t match_empty(uint64_t word) {
+        return word & ~(word << 6) & HIGH_BITS;
+    }
+
+    // High bit set in the bytes equal to tag. A byte after a real match can
+    // show up as a false positive; the caller rechecks the control byte.
+    static uint64_t match(uint64_t word, uint64_t tag) {
+        uint64_t x = word ^ (LOW_BITS * tag);
+        return (x - LOW_BITS) & ~x & HIGH_BITS;
+    }
+
+    // Index of the key's slot, or of the empty slot it would take. The
+    // first group with an empty slot ends the probe; tombstones do not.
+    size_t locate(std::string_view key, uint64_t hash, bool& found) const {
+        uint8_t tag = static_cast<uint8_t>(hash & 0x7f);
+        size_t mask = groups_ - 1;
+        size_t group = (hash >> 7) & mask;
+        // Triangular steps visit every group of a power-of-two table
+        for (size_t step = 1;; step++) {
+            uint64_t word = load_group(group);
+            for (uint64_t bits = match(word, tag); bits; bits &= bits - 1) {
+                size_t i = group * FLAT_DICT_GROUP + __builtin_ctzll(bits) / 8;
+                const Slot& slot = slots_[i];
+                if (ctrl_[i] == tag && slot.length == key.size() &&
+                    (key.empty() || std::memcmp(arena_.data() + slot.offset, key.data(), key.size()) == 0)) {
+                    found = true;
+                    return i;
+                }
+            }
+            uint64_t empty = match_empty(word);
+            if (empty) {
+                found = false;
+                return group * FLAT_DICT_GROUP + __builtin_ctzll(empty) / 8;
+            }
+            group = (group + step) & mask;
+        }
+    }
+
+    // Moves every live slot into a table of the given number of groups,
+    // dropping tombstones. The arena is compacted once it is mostly
+    // erased keys.
+    void rehash(size_t groups) {
+        std::vector<uint8_t> old_ctrl(groups * FLAT_DICT_GROUP, FLAT_DICT_EMPTY);
+        std::vector<Slot> old_slots(groups * FLAT_DICT_GROUP);
+        std::vector<char> old_arena;
+        old_ctrl.swap(ctrl_);
+        old_slots.swap(slots_);
+        groups_ = groups;
+        deleted_ = 0;
+        bool compact = dead_bytes_ > arena_.size() / 2;
+        if (compact) {
+            old_arena.swap(arena_);
+            arena_.reserve(old_arena.size() - dead_bytes_);
+            dead_bytes_ = 0;
+        }
+
+        for (size_t j = 0; j < old_ctrl.size(); j++) {
+            if (old_ctrl[j] & 0x80) continue;
+            Slot slot = old_slots[j];
+            if (compact) {
+                const char* key = old_arena.data() + slot.offset;
+                slot.offset = arena_.size();
+                arena_.insert(arena_.end(), key, key + slot.length);
+            }
+            uint64_t hash = hash_key(std::string_view(arena_.data() + slot.offset, slot.length));
+            size_t mask = groups_ - 1;
+            size_t group = (hash >> 7) & mask;
+            for (size_t step = 1;; step++) {
+                uint64_t empty = match_empty(load_group(group));
+                if (empty) {
+                    size_t i = group * FLAT_DICT_GROUP + __builtin_ctzll(empty) / 8;
+                    ctrl_[i] = old_ctrl[j];
+                    slots_[i] = slot;
+                    break;
+                }
+                group = (group + step) & mask;
+            }
+        }
+    }
+
+    std::vector<uint8_t> ctrl_;
+    std::vector<Slot> slots_;
+    std::vector<char> arena_;
+    size_t groups_{0};
+    size_t size_{0};
+    size_t deleted_{0};
+    // Arena bytes of erased keys
+    size_t dead_bytes_{0};
+};
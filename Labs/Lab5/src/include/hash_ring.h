@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string_view>
+#include <vector>
+#include "message.h"
+
+// Consistent-hash ring for key-addressed requests. Every node owns
+// RING_VNODES points on a 64-bit ring and a key belongs to the first point
+// at or after its hash, so adding a node takes over only the arcs just
+// before its own points, about 1/n of the keys, spread over all old owners.
+// Nodes use key_hash() too, to pick the keys of a Scan or Drop.
+
+#define RING_VNODES 64
+
+class HashRing {
+public:
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // FNV-1a, finished with a mixer so that short keys spread over the ring
+    static uint64_t key_hash(std::string_view key) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return mix(h);
+    }
+
+    static bool contains(const KeyRange& range, uint64_t hash) {
+        return range.from < range.to
+            ? hash > range.from && hash <= range.to
+            : hash > range.from || hash <= range.to;
+    }
+
+    static bool contains(const std::vector<KeyRange>& ranges, uint64_t hash) {
+        for (const KeyRange& range : ranges) {
+            if (contains(range, hash)) return true;
+        }
+        return false;
+    }
+
+    bool empty() const { return points_.empty(); }
+
+    void add(int node) {
+        for (uint64_t i = 0; i < RING_VNODES; i++) {
+            points_[point(node, i)] = node;
+        }
+    }
+
+    // -1 on an empty ring
+    int owner(std::string_view key) const { return owner_of(key_hash(key)); }
+
+    int owner_of(uint64_t hash) const {
+        if (points_.empty()) return -1;
+        auto it = points_.lower_bound(hash);
+        return it != points_.end() ? it->second : points_.begin()->second;
+    }
+
+    // Up to count distinct nodes for key: its owner, then the next nodes
+    // clockwise, which hold its replicas
+    std::vector<int> owners(std::string_view key, size_t count) const {
+        std::vector<int> nodes;
+        if (points_.empty()) return nodes;
+        auto it = points_.lower_bound(key_hash(key));
+        for (size_t seen = 0; seen < points_.size() && nodes.size() < count; seen++, ++it) {
+            if (it == points_.end()) it = points_.begin();
+            if (std::find(nodes.begin(), nodes.end(), it->second) == nodes.end()) {
+                nodes.push_back(it->second);
+            }
+        }
+        return nodes;
+    }
+
+    // The arcs node would take over if added, by their current owner
+    std::map<int, std::vector<KeyRange>> ranges_moving_to(int node) const {
+        std::map<int, std::vector<KeyRange>> moves;
+        if (points_.empty()) return moves;
+        HashRing next = *this;
+        next.add(node);
+        for (auto it = next.points_.begin(); it != next.points_.end(); ++it) {
+            if (it->second != node) continue;
+            auto prev = it == next.points_.begin() ? std::prev(next.points_.end()) : std::prev(it);
+            // No old point lies in (prev, it], so one old owner has all of it
+            moves[owner_of(it->first)].push_back({prev->first, it->first});
+        }
+        return moves;
+    }
+
+private:
+    static uint64_t point(int node, uint64_t i) {
+        return mix((static_cast<uint64_t>(static_cast<uint32_t>(node)) << 32 | i) + 0x9E3779B97F4A7C15ULL);
+    }
+
+    std::map<uint64_t, int> points_;
+};
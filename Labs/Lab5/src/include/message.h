@@ -1,8 +1,24 @@
 #pragma once
 
-#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "utils.h"
 
+// One key of an MSET/MGET batch. An MGET request carries keys only; the
+// reply sets found and value for each of them.
+struct KeyValue {
+    std::string key;
+    int value{0};
+    bool found{false};
+};
+
+// Hash ring interval (from, to], wrapping past the top when from >= to
+struct KeyRange {
+    uint64_t from{0};
+    uint64_t to{0};
+};
+
 class Message {
 public:
     Message() = default;
@@ -14,15 +30,13 @@ public:
         , sent_time(std::chrono::system_clock::now())
     {}
 
-    Message(CommandType cmd, int id, int add_data, const char* s)
+    Message(CommandType cmd, int id, int add_data, std::string key)
         : command(cmd)
         , id(id)
         , add_data(add_data)
         , sent_time(std::chrono::system_clock::now())
-    {
-        std::strncpy(val, s, sizeof(val) - 1);
-        val[sizeof(val) - 1] = '\0';
-    }
+        , key(std::move(key))
+    {}
 
     bool operator==(const Message& other) const {
         return command == other.command &&
@@ -34,7 +48,19 @@ public:
     CommandType command{CommandType::None};
     int id{-1};
     int add_data{-1};
+    // Set by the controller, echoed back in the reply; 0 for none
+    uint64_t request_id{0};
+    // Local to the sender, never serialized (see wire.h)
     std::chrono::system_clock::time_point sent_time;
-    char val[30]{};
+    std::string key;
+    // MSET/MGET batch, empty for single-key requests
+    std::vector<KeyValue> entries;
+    // Key hash ranges of a Scan/Drop request
+    std::vector<KeyRange> ranges;
+    // Keys placed by the hash ring (set/get), kept apart from the keys
+    // addressed to a node by id; only these move on Scan/Drop
+    bool ring{false};
+    // Heartbeat interval in ms a Create hands to the new node; 0 for none
+    uint64_t interval{0};
 };
 
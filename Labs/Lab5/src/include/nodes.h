@@ -6,14 +6,32 @@
 #include <chrono>
 #include <list>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
-// Base node
+// Per-socket queue limit in messages (zmq's default is 1000)
+#define SOCKET_HWM 100000
+
+// One ZMQ context, and so one I/O thread, per process
+void* process_context();
+
+// Every parent binds one ROUTER here and all of its children connect to it.
+// LAB5_TRANSPORT picks the kind, inherited by every node the process spawns:
+//   tcp (default)  tcp://127.0.0.1:(5555 + id); the controller (-1) is 5554
+//   ipc            ipc://$LAB5_IPC_DIR/lab5-node<id>.ipc (/tmp by default,
+//                  lab5-control.ipc for the controller); Unix sockets skip
+//                  the loopback TCP stack and need no free ports
+// A child only connects to the address it is given, so a TCP parent can
+// still serve nodes on other hosts.
+std::string router_address(int id);
+
+// A socket in the process context, closed on destruction
 class Node {
 public:
     Node() = default;
     ~Node() {
         if (socket) zmq_close(socket);
-        if (context) zmq_ctx_destroy(context);
     }
 
     // Prevent copying
@@ -30,34 +48,82 @@ public:
 
     int id{-1};
     pid_t pid{-1};
-    void* context{nullptr};
     void* socket{nullptr};
     std::string address;
 };
 
+// A spawned child. It has no socket of its own on our side: the parent's
+// ROUTER reaches it by its routing id, which is its node id as text.
+struct Child {
+    int id{-1};
+    pid_t pid{-1};
+    std::string routing_id;
+};
+
 // Funcs for node creation
-Node create_node(int id, bool is_child);
-Node create_process(int id);
+Node bind_router(int id);
+Node connect_to_parent(int id, const std::string& parent_address);
+// request_id is echoed in the child's Create announcement; the child beats
+// every heartbeat_ms from the start, or not at all for 0
+Child create_process(int id, const std::string& parent_address, uint64_t request_id, uint64_t heartbeat_ms = 0);
+// Two ends of an inproc PAIR pipe between threads of one process
+Node bind_pipe(int id, const std::string& address);
+Node connect_pipe(int id, const std::string& address);
+
+namespace zmq_lib {
+    class Frame;
+}
+
+class DictionaryWorker;
+
+// A batch request split over several workers, answered once every part is in
+struct Gather {
+    Message reply;
+    size_t parts_left{0};
+    // A part could not be handed to its worker; the answer is ExecErr
+    bool failed{false};
+    // MGET: where the answers of each worker go in reply.entries
+    std::vector<std::vector<uint32_t>> positions;
+};
 
-// Child node
+// Child node. The calling thread does all I/O: it forwards traffic for the
+// subtree, sends heartbeats and hands dictionary requests to
+// $LAB5_WORKERS (default 1) worker threads, each owning the keys of one
+// hash shard. Batch, Scan and Drop requests are split over the workers and
+// their replies merged, so the parent still sees one reply per request.
 class ComputingNode {
 private:
     Node node_;
-    std::map<std::string, int> dictionary_;
-    std::list<Node> children_;
+    // Bound when the first child is created
+    Node router_;
+    std::vector<std::unique_ptr<DictionaryWorker>> workers_;
+    // Requests the workers have not answered yet, by pipe tag: 0 to pass
+    // the reply up as is, otherwise the id of the gather it belongs to
+    std::unordered_map<uint64_t, uint64_t> in_pipes_;
+    uint64_t next_tag_{1};
+    std::unordered_map<uint64_t, Gather> gathers_;
+    uint64_t next_gather_{1};
+    std::list<Child> children_;
+    // Every node in our subtree -> the child it lives under
+    std::unordered_map<int, Child*> routes_;
     std::chrono::milliseconds heartbeat = std::chrono::milliseconds::zero();
     std::chrono::system_clock::time_point last_beat = now();
 
     void handle_create(const Message& message);
     void handle_ping(const Message& message);
     void handle_heartbeat(const Message& message);
-    void handle_exec_add(const Message& message);
-    void handle_exec_find(const Message& message);
     void broadcast_to_children(const Message& message);
+    void route_to_child(zmq_lib::Frame& frame);
+    void handle_parent_message(const Message& message);
+    void send_to_worker(size_t worker, const Message& message, uint64_t gather);
+    void split_batch(const Message& message);
+    void broadcast_to_workers(const Message& message);
+    void handle_worker_reply(size_t worker, uint64_t tag, zmq_lib::Frame& frame);
+    void part_done(std::unordered_map<uint64_t, Gather>::iterator it);
 
 public:
-    explicit ComputingNode(int id)
-        : node_(create_node(id, true)) {}
+    ComputingNode(int id, const std::string& parent_address, uint64_t request_id, uint64_t heartbeat_ms);
+    ~ComputingNode();
 
     void run();
 };
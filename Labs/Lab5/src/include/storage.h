@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "flat_dict.h"
+
+// Durable copy of a node dictionary in $LAB5_DATA_DIR, two files per
+// dictionary shard, named after it (node_<id> or node_<id>.<worker>):
+//
+//   <name>.wal      append-only log of (key, value) writes. Each record is
+//                   u32 key length, i32 value, u32 checksum, key bytes;
+//                   WAL_ERASE in the length marks an erased key.
+//   <name>.snap     compact snapshot, laid out to be used straight from
+//                   mmap: a SnapshotHeader, count SnapshotEntry records
+//                   and then the key bytes they point into.
+//
+// Writes are buffered by append() and made durable by commit() with one
+// write and one fdatasync, so a burst of requests shares a single sync
+// (group commit). Once the log outgrows WAL_SNAPSHOT_BYTES, snapshot()
+// writes the whole dictionary to a new file, renames it over the old one
+// and empties the log. Recovery maps the snapshot and replays the log
+// after it; a torn record at the end of the log is cut off.
+//
+// All fields are in host byte order.
+
+#define WAL_SNAPSHOT_BYTES (64UL << 20)
+#define SNAPSHOT_MAGIC "L5SNAP1"
+#define WAL_ERASE 0x80000000u
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t count;
+    uint64_t key_bytes;
+};
+
+struct SnapshotEntry {
+    // Relative to the first key byte
+    uint64_t offset;
+    uint32_t length;
+    int32_t value;
+};
+
+struct RecoveryStats {
+    uint64_t snapshot_keys;
+    uint64_t log_records;
+    double seconds;
+};
+
+class Storage {
+public:
+    // Throws std::runtime_error if the files cannot be opened
+    Storage(const std::string& dir, const std::string& name);
+    ~Storage();
+
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    // Loads the snapshot and the log into dict; call once, before writing
+    RecoveryStats recover(FlatDict& dict);
+
+    void append(std::string_view key, int value);
+    void append_erase(std::string_view key);
+    // Bytes appended but not committed yet
+    size_t pending_bytes() const { return buffer_.size(); }
+    // Writes and syncs everything appended since the last commit
+    void commit();
+
+    bool wants_snapshot() const { return log_bytes_ >= WAL_SNAPSHOT_BYTES; }
+    // Replaces the snapshot with dict and truncates the log; commit first
+    void snapshot(const FlatDict& dict);
+
+private:
+    std::string dir_;
+    std::string log_path_;
+    std::string snapshot_path_;
+    int log_fd_{-1};
+    uint64_t log_bytes_{0};
+    std::string buffer_;
+
+    void append_record(uint32_t length, int32_t value, std::string_view key);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Hashed timing wheel for request timeouts. Scheduling is O(1) and expiry
+// only visits the slots of ticks that have passed. Entries are not removed
+// when a request completes: the owner ignores expired ids it no longer
+// tracks. Deadlines further away than the wheel span wait extra rounds.
+class TimerWheel {
+public:
+    using clock = std::chrono::system_clock;
+
+    TimerWheel(std::chrono::milliseconds tick, size_t slots)
+        : tick_(tick)
+        , slots_(slots)
+        , current_(floor_tick(clock::now()))
+    {}
+
+    void schedule(uint64_t id, clock::time_point deadline) {
+        // Rounded up, so nothing fires before its deadline
+        int64_t tick = std::max(ceil_tick(deadline), current_);
+        slots_[tick % slots_.size()].push_back({id, tick});
+        size_++;
+    }
+
+    // Appends the ids whose deadline is at or before now
+    void expire(clock::time_point now, std::vector<uint64_t>& expired) {
+        int64_t now_tick = floor_tick(now);
+        if (now_tick < current_) return;
+
+        // After a long stall every slot is visited once, not once per tick
+        int64_t last = std::min<int64_t>(now_tick, current_ + slots_.size() - 1);
+        for (int64_t t = current_; t <= last; t++) {
+            auto& slot = slots_[t % slots_.size()];
+            size_t kept = 0;
+            for (const Entry& entry : slot) {
+                if (entry.tick <= now_tick) {
+                    expired.push_back(entry.id);
+                } else {
+                    slot[kept++] = entry;
+                }
+            }
+            size_ -= slot.size() - kept;
+            slot.resize(kept);
+        }
+        current_ = now_tick + 1;
+    }
+
+    // Start of the next tick that has entries (possibly for a later round),
+    // or time_point::max() if the wheel is empty
+    clock::time_point next_deadline() const {
+        if (size_ == 0) return clock::time_point::max();
+        for (size_t k = 0; k < slots_.size(); k++) {
+            if (!slots_[(current_ + k) % slots_.size()].empty()) {
+                return clock::time_point(tick_ * (current_ + static_cast<int64_t>(k)));
+            }
+        }
+        return clock::time_point::max();
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        uint64_t id;
+        int64_t tick;
+    };
+
+    int64_t floor_tick(clock::time_point t) const {
+        return std::chrono::floor<std::chrono::milliseconds>(t.time_since_epoch()) / tick_;
+    }
+
+    int64_t ceil_tick(clock::time_point t) const {
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(t.time_since_epoch());
+        return (ms + tick_ - std::chrono::milliseconds(1)) / tick_;
+    }
+
+    std::chrono::milliseconds tick_;
+    std::vector<std::vector<Entry>> slots_;
+    int64_t current_;
+    size_t size_{0};
+};
@@ -4,6 +4,7 @@
 #include "unordered_set"
 #include <unistd.h>
 #include <iostream>
+#include <string>
 
 // Command types for inter-process communication
 enum class CommandType : uint8_t {
@@ -14,9 +15,36 @@ enum class CommandType : uint8_t {
     ExecFnd = 4,
     ExecErr = 5,
     HeartBeat = 6,
+    ExecMSet = 7,
+    ExecMGet = 8,
+    Scan = 9,
+    Drop = 10,
 };
 
 
 // Helper functions
-bool input_available();
 std::chrono::system_clock::time_point now();
+
+// Lines read from a file descriptor with read(2), so that poll() on the fd
+// and what is left to parse always agree
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    // One read() of whatever the fd holds; false once it reached EOF or failed
+    bool fill();
+    // A complete line is buffered, or the unterminated rest after EOF
+    bool has_line() const;
+    // Pops the next line without its newline
+    bool next_line(std::string& line);
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t start_{0};
+    bool eof_{false};
+};
+
+// zmq_poll timeout in milliseconds until deadline: 0 if it has passed,
+// -1 (wait forever) for time_point::max().
+long poll_timeout(std::chrono::system_clock::time_point deadline);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "message.h"
+
+// Wire format of a Message, version 5:
+//
+//   u8      version (WIRE_VERSION)
+//   u8      command
+//   u8      flags: WIRE_HAS_ADD_DATA, WIRE_HAS_KEY, WIRE_HAS_REQUEST,
+//                  WIRE_HAS_ENTRIES, WIRE_HAS_RANGES, WIRE_RING,
+//                  WIRE_HAS_INTERVAL
+//   varint  id, zigzag-encoded
+//   varint  add_data, zigzag-encoded      if WIRE_HAS_ADD_DATA
+//   varint  key length, then key bytes    if WIRE_HAS_KEY
+//   varint  request_id                     if WIRE_HAS_REQUEST
+//   varint  entry count, then entries      if WIRE_HAS_ENTRIES
+//   varint  range count, then varint from  if WIRE_HAS_RANGES
+//           and varint to for each range
+//   varint  interval                       if WIRE_HAS_INTERVAL
+//
+// Each entry is a varint key length, the key bytes, a u8 found flag and,
+// if found, a zigzag varint value. add_data == -1, an empty key,
+// request_id == 0, empty batches or ranges and interval == 0 are left out. WIRE_RING has
+// no body, it is Message::ring. sent_time never goes on
+// the wire; it is local bookkeeping for the controller. The first four
+// fields form the header, which is enough to route a message, so nodes
+// forward frames without touching the body.
+
+// Versions 2 to 5 each only added a flag and its field (request ids,
+// MSET/MGET entries, Scan/Drop ranges, the ring keyspace), so a message
+// from any of them reads the same way and all are accepted. New optional
+// fields get a flag bit instead of a new version; decoders reject flags
+// they do not know. The version changes only if an existing field changes.
+#define WIRE_VERSION 5
+#define WIRE_MIN_VERSION 1
+#define WIRE_HAS_ADD_DATA 0x01
+#define WIRE_HAS_KEY 0x02
+#define WIRE_HAS_REQUEST 0x04
+#define WIRE_HAS_ENTRIES 0x08
+#define WIRE_HAS_RANGES 0x10
+#define WIRE_RING 0x20
+#define WIRE_HAS_INTERVAL 0x40
+#define WIRE_KNOWN_FLAGS 0x7f
+// Version, command, flags and the longest varint id
+#define WIRE_MAX_HEADER 8
+
+struct WireHeader {
+    CommandType command{CommandType::None};
+    int id{-1};
+};
+
+std::string encode_message(const Message& msg);
+
+// Both reject unknown versions and flags and truncated or oversized input
+bool decode_header(const void* data, size_t size, WireHeader& header);
+bool decode_message(const void* data, size_t size, Message& msg);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "flat_dict.h"
+#include "nodes.h"
+#include "storage.h"
+
+// Limits of one group commit: held back replies and buffered log bytes
+#define WAL_GROUP_MAX 1024
+#define WAL_GROUP_BYTES (4UL << 20)
+#define MAX_WORKERS 64
+
+// Which worker of count serves key
+size_t worker_shard(std::string_view key, size_t count);
+
+// One shard of a node dictionary, served on its own thread. The node's
+// I/O thread sends it tagged requests over an inproc PAIR socket and gets
+// exactly one reply per request back, in order and with the same tag. Keys addressed to the
+// node by id and keys placed by the hash ring (Message::ring) live in two
+// separate keyspaces. With persistence on, the worker keeps a log and a
+// snapshot per keyspace and holds replies to writes until a group commit
+// has synced them.
+class DictionaryWorker {
+public:
+    // storage_name is the file name stem in data_dir, with ".ring" added
+    // for the ring keyspace; data_dir may be null
+    DictionaryWorker(int node_id, int index, const char* data_dir, const std::string& storage_name);
+    // Stops the thread after the requests already queued
+    ~DictionaryWorker();
+
+    DictionaryWorker(const DictionaryWorker&) = delete;
+    DictionaryWorker& operator=(const DictionaryWorker&) = delete;
+
+    // The I/O thread's end of the pipe
+    Node& pipe() { return io_; }
+
+private:
+    struct Keyspace {
+        FlatDict dictionary;
+        std::unique_ptr<Storage> storage;
+    };
+
+    int node_id_;
+    int index_;
+    Node io_;
+    Node worker_;
+    Keyspace own_;
+    Keyspace ring_;
+    // Tag and reply of everything answered since the last flush
+    std::vector<std::pair<uint64_t, Message>> replies_;
+    uint64_t tag_{0};
+    std::thread thread_;
+
+    void run();
+    Keyspace& keyspace(const Message& message) { return message.ring ? ring_ : own_; }
+    void recover(Keyspace& keyspace, const char* name);
+    size_t pending_bytes() const;
+    void handle(const Message& message);
+    void handle_exec_add(const Message& message);
+    void handle_exec_find(const Message& message);
+    void handle_exec_mset(const Message& message);
+    void handle_exec_mget(const Message& message);
+    void handle_scan(const Message& message);
+    void handle_drop(const Message& message);
+    void write(Keyspace& keyspace, std::string_view key, int value);
+    void answer(Message message);
+    void flush();
+};
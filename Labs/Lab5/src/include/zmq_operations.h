@@ -1,8 +1,53 @@
 #pragma once
 
 #include "nodes.h"
+#include "wire.h"
 
 namespace zmq_lib {
+    // A received message still in wire form. Only the header is decoded,
+    // so it can be routed and forwarded without copying the body.
+    class Frame {
+    public:
+        Frame() { zmq_msg_init(&msg_); }
+        ~Frame() { zmq_msg_close(&msg_); }
+
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+
+        const WireHeader& header() const { return header_; }
+        const void* data() { return zmq_msg_data(&msg_); }
+        size_t size() const { return zmq_msg_size(&msg_); }
+        bool decode(Message& msg) { return decode_message(data(), size(), msg); }
+
+    private:
+        friend bool receive_frame(Node& node, Frame& frame);
+        friend bool receive_frame(Node& router, Frame& frame, int& child_id);
+        friend void forward(Node& node, Frame& frame);
+        friend void forward(Node& router, const Child& child, Frame& frame);
+        friend bool receive_tagged(Node& pipe, uint64_t& tag, Frame& frame);
+
+        zmq_msg_t msg_;
+        WireHeader header_;
+    };
+
     void send_message(Node& node, const Message& msg);
     Message receive_message(Node& node);
+
+    // ROUTER side: one routing-id frame, then the message
+    void send_message(Node& router, const Child& child, const Message& msg);
+    Message receive_message(Node& router, int& child_id);
+
+    // Non-blocking; skips frames with a bad header. False when nothing is left.
+    bool receive_frame(Node& node, Frame& frame);
+    bool receive_frame(Node& router, Frame& frame, int& child_id);
+
+    // Hand the frame on unchanged; the frame is empty afterwards
+    void forward(Node& node, Frame& frame);
+    void forward(Node& router, const Child& child, Frame& frame);
+
+    // Worker pipes put a tag frame before every message and its reply, so
+    // replies are matched to requests by tag, not by position. A blocking
+    // send waits for room; otherwise false means nothing was sent.
+    bool send_tagged(Node& pipe, uint64_t tag, const Message& msg, bool block);
+    bool receive_tagged(Node& pipe, uint64_t& tag, Frame& frame);
 }
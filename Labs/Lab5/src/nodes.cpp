@@ -1,69 +1,124 @@
 #include "zmq_operations.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
 
 Node::Node(Node&& other) noexcept
     : id(other.id)
     , pid(other.pid)
-    , context(other.context)
     , socket(other.socket)
     , address(std::move(other.address))
 {
-    other.context = nullptr;
     other.socket = nullptr;
 }
 
 Node& Node::operator=(Node&& other) noexcept {
     if (this != &other) {
         if (socket) zmq_close(socket);
-        if (context) zmq_ctx_destroy(context);
 
         id = other.id;
         pid = other.pid;
-        context = other.context;
         socket = other.socket;
         address = std::move(other.address);
 
-        other.context = nullptr;
         other.socket = nullptr;
     }
     return *this;
 }
 
 
-Node create_node(int id, bool is_child) {
+void* process_context() {
+    static void* context = [] {
+        void* ctx = zmq_ctx_new();
+        if (!ctx) {
+            throw std::runtime_error("Failed to create ZMQ context");
+        }
+        return ctx;
+    }();
+    return context;
+}
+
+std::string router_address(int id) {
+    const char* transport = std::getenv("LAB5_TRANSPORT");
+    if (transport && std::string(transport) == "ipc") {
+        const char* dir = std::getenv("LAB5_IPC_DIR");
+        std::string name = id < 0 ? "lab5-control" : "lab5-node" + std::to_string(id);
+        return "ipc://" + std::string(dir && *dir ? dir : "/tmp") + "/" + name + ".ipc";
+    }
+    if (transport && *transport && std::string(transport) != "tcp") {
+        throw std::runtime_error("Unknown LAB5_TRANSPORT " + std::string(transport) + ", use tcp or ipc");
+    }
+    return "tcp://127.0.0.1:" + std::to_string(5555 + id);
+}
+
+static Node create_socket(int id, int type) {
     Node node;
     node.id = id;
     node.pid = getpid();
 
-    node.context = zmq_ctx_new();
-    if (!node.context) {
-        throw std::runtime_error("Failed to create ZMQ context");
-    }
-
-    node.socket = zmq_socket(node.context, ZMQ_DEALER);
+    node.socket = zmq_socket(process_context(), type);
     if (!node.socket) {
-        zmq_ctx_destroy(node.context);
         throw std::runtime_error("Failed to create ZMQ socket");
     }
 
-    node.address = "tcp://127.0.0.1:" + std::to_string(5555 + id);
+    // Sends never block, so a full queue drops the message; leave room
+    // for thousands of pipelined requests per link
+    int hwm = SOCKET_HWM;
+    zmq_setsockopt(node.socket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(node.socket, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    return node;
+}
 
-    int rc = is_child
-        ? zmq_connect(node.socket, node.address.c_str())
-        : zmq_bind(node.socket, node.address.c_str());
+Node bind_router(int id) {
+    Node node = create_socket(id, ZMQ_ROUTER);
+    node.address = router_address(id);
 
-    if (rc != 0) {
-        throw std::runtime_error("Failed to " +
-            std::string(is_child ? "connect" : "bind") +
-            " ZMQ socket");
+    if (zmq_bind(node.socket, node.address.c_str()) != 0) {
+        throw std::runtime_error("Failed to bind ZMQ socket to " + node.address);
     }
+    return node;
+}
+
+Node connect_to_parent(int id, const std::string& parent_address) {
+    Node node = create_socket(id, ZMQ_DEALER);
+    node.address = parent_address;
 
+    std::string routing_id = std::to_string(id);
+    zmq_setsockopt(node.socket, ZMQ_ROUTING_ID, routing_id.data(), routing_id.size());
+
+    if (zmq_connect(node.socket, node.address.c_str()) != 0) {
+        throw std::runtime_error("Failed to connect ZMQ socket to " + node.address);
+    }
     return node;
 }
 
-Node create_process(int id) {
+Node bind_pipe(int id, const std::string& address) {
+    Node node = create_socket(id, ZMQ_PAIR);
+    node.address = address;
+    if (zmq_bind(node.socket, node.address.c_str()) != 0) {
+        throw std::runtime_error("Failed to bind ZMQ socket to " + node.address);
+    }
+    return node;
+}
+
+Node connect_pipe(int id, const std::string& address) {
+    Node node = create_socket(id, ZMQ_PAIR);
+    node.address = address;
+    if (zmq_connect(node.socket, node.address.c_str()) != 0) {
+        throw std::runtime_error("Failed to connect ZMQ socket to " + node.address);
+    }
+    return node;
+}
+
+Child create_process(int id, const std::string& parent_address, uint64_t request_id, uint64_t heartbeat_ms) {
     pid_t pid = fork();
     if (pid == 0) {
-        execl("./computing", "computing", std::to_string(id).c_str(), nullptr);
+        execl("./computing", "computing", std::to_string(id).c_str(), parent_address.c_str(),
+              std::to_string(request_id).c_str(), std::to_string(heartbeat_ms).c_str(), nullptr);
         std::cerr << "execl failed: " << strerror(errno) << std::endl;
         exit(1);
     }
@@ -72,27 +127,75 @@ Node create_process(int id) {
             std::string(strerror(errno)));
     }
 
-    Node node = create_node(id, false);
-    node.pid = pid;
-    return node;
+    Child child;
+    child.id = id;
+    child.pid = pid;
+    child.routing_id = std::to_string(id);
+    return child;
+}
+
+// Keys are sharded by worker, so the data files only make sense for the
+// worker count that wrote them
+static void check_worker_layout(const std::string& dir, int id, size_t count) {
+    std::string base = dir + "/node_" + std::to_string(id);
+    size_t stored = 0;
+    std::ifstream in(base + ".workers");
+    struct stat st;
+    if (!(in >> stored) && stat((base + ".wal").c_str(), &st) == 0) {
+        stored = 1;
+    }
+    if (stored != 0 && stored != count) {
+        throw std::runtime_error(base + " was written by " + std::to_string(stored) +
+                                 " workers; run with LAB5_WORKERS=" + std::to_string(stored));
+    }
+    mkdir(dir.c_str(), 0755);
+    std::ofstream(base + ".workers") << count << "\n";
+}
+
+ComputingNode::ComputingNode(int id, const std::string& parent_address, uint64_t request_id, uint64_t heartbeat_ms)
+    : node_(connect_to_parent(id, parent_address))
+    , heartbeat(heartbeat_ms)
+{
+    const char* workers = std::getenv("LAB5_WORKERS");
+    size_t count = workers && *workers ? std::strtoul(workers, nullptr, 10) : 1;
+    count = std::clamp<size_t>(count, 1, MAX_WORKERS);
+
+    const char* data_dir = std::getenv("LAB5_DATA_DIR");
+    if (data_dir && !*data_dir) {
+        data_dir = nullptr;
+    }
+    if (data_dir) {
+        check_worker_layout(data_dir, id, count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        std::string name = "node_" + std::to_string(id);
+        if (count > 1) {
+            name += "." + std::to_string(i);
+        }
+        workers_.push_back(std::make_unique<DictionaryWorker>(id, static_cast<int>(i), data_dir, name));
+    }
+
+    // Announce ourselves; this doubles as the reply to the Create request,
+    // so nobody routes to us before our parent's ROUTER knows us
+    Message created(CommandType::Create, id, getpid());
+    created.request_id = request_id;
+    zmq_lib::send_message(node_, created);
 }
 
+// Workers finish what is queued and stop
+ComputingNode::~ComputingNode() = default;
+
 void ComputingNode::handle_create(const Message& message) {
-    if (message.id == node_.id) {
-        Node child = create_process(message.add_data);
-        children_.push_back(std::move(child));
-        zmq_lib::send_message(node_, Message(CommandType::Create, child.id, child.pid));
-    } else {
-        broadcast_to_children(message);
+    if (!router_.socket) {
+        router_ = bind_router(node_.id);
     }
+    // The child reports Create itself once it is connected
+    children_.push_back(create_process(message.add_data, router_.address, message.request_id, message.interval));
+    routes_[message.add_data] = &children_.back();
 }
 
 void ComputingNode::handle_ping(const Message& message) {
-    if (message.id == node_.id) {
-        zmq_lib::send_message(node_, message);
-    } else {
-        broadcast_to_children(message);
-    }
+    zmq_lib::send_message(node_, message);
 }
 
 void ComputingNode::handle_heartbeat(const Message& message) {
@@ -100,76 +203,247 @@ void ComputingNode::handle_heartbeat(const Message& message) {
     broadcast_to_children(message);
 }
 
-void ComputingNode::handle_exec_add(const Message& message) {
-    if (message.id == node_.id) {
-        dictionary_[std::string(message.val)] = message.add_data;
-        zmq_lib::send_message(node_, message);
-    } else {
-        broadcast_to_children(message);
+// A worker whose queue is full gets nothing, and the request is answered
+// right away instead of never, with an ExecErr without a key
+void ComputingNode::send_to_worker(size_t worker, const Message& message, uint64_t gather) {
+    uint64_t tag = next_tag_++;
+    if (zmq_lib::send_tagged(workers_[worker]->pipe(), tag, message, false)) {
+        in_pipes_.emplace(tag, gather);
+        return;
+    }
+    if (gather == 0) {
+        Message reply(CommandType::ExecErr, node_.id, -1);
+        reply.request_id = message.request_id;
+        zmq_lib::send_message(node_, reply);
+        return;
     }
+    auto it = gathers_.find(gather);
+    it->second.failed = true;
+    part_done(it);
 }
 
-void ComputingNode::handle_exec_find(const Message& message) {
-    if (message.id == node_.id) {
-        auto it = dictionary_.find(std::string(message.val));
-        if (it != dictionary_.end()) {
-            zmq_lib::send_message(node_, Message(CommandType::ExecFnd,
-                node_.id, it->second, message.val));
-        } else {
-            zmq_lib::send_message(node_, Message(CommandType::ExecErr,
-                node_.id, -1, message.val));
+// Gives every worker the keys of its shard; the reply goes up once all
+// parts are back
+void ComputingNode::split_batch(const Message& message) {
+    if (workers_.size() == 1) {
+        send_to_worker(0, message, 0);
+        return;
+    }
+    std::vector<Message> parts(workers_.size(), Message(message.command, message.id, -1));
+    for (Message& part : parts) {
+        part.ring = message.ring;
+    }
+    Gather gather;
+    gather.reply = Message(message.command, node_.id, 0);
+    gather.reply.request_id = message.request_id;
+    gather.positions.resize(workers_.size());
+    for (size_t i = 0; i < message.entries.size(); i++) {
+        size_t worker = worker_shard(message.entries[i].key, workers_.size());
+        parts[worker].entries.push_back(message.entries[i]);
+        gather.positions[worker].push_back(static_cast<uint32_t>(i));
+    }
+    if (message.command == CommandType::ExecMGet) {
+        gather.reply.entries.resize(message.entries.size());
+    }
+    for (const Message& part : parts) {
+        gather.parts_left += !part.entries.empty();
+    }
+    if (gather.parts_left == 0) {
+        zmq_lib::send_message(node_, gather.reply);
+        return;
+    }
+    uint64_t id = next_gather_++;
+    gathers_.emplace(id, std::move(gather));
+    for (size_t worker = 0; worker < workers_.size(); worker++) {
+        if (!parts[worker].entries.empty()) {
+            send_to_worker(worker, parts[worker], id);
+        }
+    }
+}
+
+// Scan and Drop cover every shard
+void ComputingNode::broadcast_to_workers(const Message& message) {
+    if (workers_.size() == 1) {
+        send_to_worker(0, message, 0);
+        return;
+    }
+    Gather gather;
+    gather.reply = Message(message.command, node_.id, 0);
+    gather.reply.request_id = message.request_id;
+    gather.parts_left = workers_.size();
+    uint64_t id = next_gather_++;
+    gathers_.emplace(id, std::move(gather));
+    for (size_t worker = 0; worker < workers_.size(); worker++) {
+        send_to_worker(worker, message, id);
+    }
+}
+
+void ComputingNode::handle_worker_reply(size_t worker, uint64_t tag, zmq_lib::Frame& frame) {
+    auto pipe = in_pipes_.find(tag);
+    if (pipe == in_pipes_.end()) {
+        return;
+    }
+    uint64_t id = pipe->second;
+    in_pipes_.erase(pipe);
+    if (id == 0) {
+        zmq_lib::forward(node_, frame);
+        return;
+    }
+
+    auto it = gathers_.find(id);
+    Message part;
+    if (it == gathers_.end() || !frame.decode(part)) {
+        return;
+    }
+    Gather& gather = it->second;
+    if (part.command == CommandType::ExecMGet) {
+        const std::vector<uint32_t>& positions = gather.positions[worker];
+        for (size_t j = 0; j < part.entries.size() && j < positions.size(); j++) {
+            gather.reply.entries[positions[j]] = std::move(part.entries[j]);
         }
+        gather.reply.add_data += static_cast<int>(part.entries.size());
+    } else if (part.command == CommandType::Scan) {
+        gather.reply.add_data += static_cast<int>(part.entries.size());
+        std::move(part.entries.begin(), part.entries.end(), std::back_inserter(gather.reply.entries));
+    } else if (part.command == CommandType::ExecErr) {
+        gather.failed = true;
+    } else {
+        // MSET and Drop answer with a count
+        gather.reply.add_data += part.add_data;
+    }
+    part_done(it);
+}
+
+// Sends the merged reply once the last part is in
+void ComputingNode::part_done(std::unordered_map<uint64_t, Gather>::iterator it) {
+    Gather& gather = it->second;
+    if (--gather.parts_left > 0) {
+        return;
+    }
+    if (gather.failed) {
+        Message reply(CommandType::ExecErr, node_.id, -1);
+        reply.request_id = gather.reply.request_id;
+        zmq_lib::send_message(node_, reply);
     } else {
-        broadcast_to_children(message);
+        zmq_lib::send_message(node_, gather.reply);
+    }
+    gathers_.erase(it);
+}
+
+// Passes the frame one level down toward its target without decoding the
+// body; ids outside our subtree are dropped and the controller reports
+// them on timeout
+void ComputingNode::route_to_child(zmq_lib::Frame& frame) {
+    auto it = routes_.find(frame.header().id);
+    if (it != routes_.end()) {
+        zmq_lib::forward(router_, *it->second, frame);
     }
 }
 
 void ComputingNode::broadcast_to_children(const Message& message) {
     for (auto& child : children_) {
-        zmq_lib::send_message(child, message);
+        zmq_lib::send_message(router_, child, message);
     }
 }
 
 
+void ComputingNode::handle_parent_message(const Message& message) {
+    switch (message.command) {
+    case CommandType::Create:
+            handle_create(message);
+            break;
+    case CommandType::Ping:
+            handle_ping(message);
+            break;
+    case CommandType::HeartBeat:
+        handle_heartbeat(message);
+        break;
+    case CommandType::ExecAdd:
+    case CommandType::ExecFnd:
+        send_to_worker(worker_shard(message.key, workers_.size()), message, 0);
+        break;
+    case CommandType::ExecMSet:
+    case CommandType::ExecMGet:
+        split_batch(message);
+        break;
+    case CommandType::Scan:
+    case CommandType::Drop:
+        broadcast_to_workers(message);
+        break;
+    default:
+        break;
+    }
+}
+
 void ComputingNode::run() {
+    std::vector<zmq_pollitem_t> items;
     while (true) {
+        // Sleep until the parent, a child or a worker sends something, or
+        // the next beat is due
+        items.clear();
+        items.push_back({node_.socket, 0, ZMQ_POLLIN, 0});
+        if (router_.socket) {
+            items.push_back({router_.socket, 0, ZMQ_POLLIN, 0});
+        }
+        size_t first_worker = items.size();
+        for (auto& worker : workers_) {
+            items.push_back({worker->pipe().socket, 0, ZMQ_POLLIN, 0});
+        }
+        long timeout = heartbeat > std::chrono::milliseconds::zero()
+            ? poll_timeout(last_beat + heartbeat)
+            : -1;
+
+        if (zmq_poll(items.data(), static_cast<int>(items.size()), timeout) < 0) {
+            if (zmq_errno() == EINTR) continue;
+            throw std::runtime_error("zmq_poll failed: " + std::string(zmq_strerror(zmq_errno())));
+        }
+
         // Handle children messages
-        for (auto& child : children_) {
-            Message message = zmq_lib::receive_message(child);
-            if (message.command != CommandType::None) {
-                zmq_lib::send_message(node_, message);
+        if (router_.socket && (items[1].revents & ZMQ_POLLIN)) {
+            zmq_lib::Frame frame;
+            int sender;
+            while (zmq_lib::receive_frame(router_, frame, sender)) {
+                auto child = routes_.find(sender);
+                if (child == routes_.end()) {
+                    continue;
+                }
+                if (frame.header().command == CommandType::Create) {
+                    // A node was created somewhere below this child
+                    routes_[frame.header().id] = child->second;
+                }
+                zmq_lib::forward(node_, frame);
             }
         }
 
-        if (heartbeat > std::chrono::milliseconds::zero() &&
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                now() - last_beat).count() > heartbeat.count())
-        {
+        if (heartbeat > std::chrono::milliseconds::zero() && now() >= last_beat + heartbeat) {
             zmq_lib::send_message(node_, Message(CommandType::HeartBeat, node_.id, -1));
             last_beat = now();
         }
 
         // Handle parent messages
-        Message message = zmq_lib::receive_message(node_);
-
-        switch (message.command) {
-        case CommandType::Create:
-                handle_create(message);
-                break;
-        case CommandType::Ping:
-                handle_ping(message);
-                break;
-        case CommandType::HeartBeat:
-            handle_heartbeat(message);
-            break;
-        case CommandType::ExecAdd:
-            handle_exec_add(message);
-            break;
-        case CommandType::ExecFnd:
-            handle_exec_find(message);
-            break;
-        default:
-            break;
+        if (items[0].revents & ZMQ_POLLIN) {
+            zmq_lib::Frame frame;
+            while (zmq_lib::receive_frame(node_, frame)) {
+                if (frame.header().command != CommandType::HeartBeat && frame.header().id != node_.id) {
+                    route_to_child(frame);
+                    continue;
+                }
+                Message message;
+                if (frame.decode(message)) {
+                    handle_parent_message(message);
+                }
+            }
+        }
+
+        // Replies from the workers go up in the order each worker sends them
+        for (size_t worker = 0; worker < workers_.size(); worker++) {
+            if (items[first_worker + worker].revents & ZMQ_POLLIN) {
+                zmq_lib::Frame frame;
+                uint64_t tag;
+                while (zmq_lib::receive_tagged(workers_[worker]->pipe(), tag, frame)) {
+                    handle_worker_reply(worker, tag, frame);
+                }
+            }
         }
     }
 }
@@ -0,0 +1,239 @@
+#include "storage.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WAL_RECORD_HEADER 12
+// Snapshot writes go out in chunks of this size
+#define SNAPSHOT_CHUNK (1UL << 20)
+
+static std::runtime_error io_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + strerror(errno));
+}
+
+static uint32_t record_checksum(uint32_t length, int32_t value, std::string_view key) {
+    uint32_t h = 2166136261u;
+    auto add = [&h](const void* data, size_t size) {
+        auto p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            h ^= p[i];
+            h *= 16777619u;
+        }
+    };
+    add(&length, sizeof(length));
+    add(&value, sizeof(value));
+    add(key.data(), key.size());
+    return h;
+}
+
+static void write_all(int fd, const char* data, size_t size, const std::string& path) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("Cannot write", path);
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Read-only private mapping of a whole file; empty files map to nothing
+class MappedFile {
+public:
+    MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno != ENOENT) throw io_error("Cannot open", path);
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_ = st.st_size;
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw io_error("Cannot map", path);
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_{nullptr};
+    size_t size_{0};
+};
+
+Storage::Storage(const std::string& dir, const std::string& name)
+    : dir_(dir)
+    , log_path_(dir + "/" + name + ".wal")
+    , snapshot_path_(dir + "/" + name + ".snap")
+{
+    mkdir(dir_.c_str(), 0755);
+    log_fd_ = open(log_path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (log_fd_ < 0) {
+        throw io_error("Cannot open", log_path_);
+    }
+}
+
+Storage::~Storage() {
+    if (log_fd_ >= 0) close(log_fd_);
+}
+
+RecoveryStats Storage::recover(FlatDict& dict) {
+    auto start = std::chrono::steady_clock::now();
+    RecoveryStats stats{0, 0, 0.0};
+
+    {
+        MappedFile snapshot(snapshot_path_);
+        if (snapshot.size() > 0) {
+            const auto* header = reinterpret_cast<const SnapshotHeader*>(snapshot.data());
+            if (snapshot.size() < sizeof(SnapshotHeader) ||
+                std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+                header->count > (snapshot.size() - sizeof(SnapshotHeader)) / sizeof(SnapshotEntry) ||
+                sizeof(SnapshotHeader) + header->count * sizeof(SnapshotEntry) + header->key_bytes != snapshot.size()) {
+                throw std::runtime_error("Corrupt snapshot " + snapshot_path_);
+            }
+            const auto* entries = reinterpret_cast<const SnapshotEntry*>(header + 1);
+            const char* keys = reinterpret_cast<const char*>(entries + header->count);
+            dict.reserve(header->count);
+            for (uint64_t i = 0; i < header->count; i++) {
+                const SnapshotEntry& entry = entries[i];
+                if (entry.offset + entry.length > header->key_bytes) {
+                    throw std::runtime_error("Corrupt snapshot " + snapshot_path_);
+                }
+                dict[std::string_view(keys + entry.offset, entry.length)] = entry.value;
+            }
+            stats.snapshot_keys = header->count;
+        }
+    }
+
+    MappedFile log(log_path_);
+    size_t pos = 0;
+    while (log.size() - pos >= WAL_RECORD_HEADER) {
+        uint32_t length, checksum;
+        int32_t value;
+        std::memcpy(&length, log.data() + pos, sizeof(length));
+        std::memcpy(&value, log.data() + pos + 4, sizeof(value));
+        std::memcpy(&checksum, log.data() + pos + 8, sizeof(checksum));
+        uint32_t key_length = length & ~WAL_ERASE;
+        if (key_length > log.size() - pos - WAL_RECORD_HEADER) break;
+        std::string_view key(log.data() + pos + WAL_RECORD_HEADER, key_length);
+        if (record_checksum(length, value, key) != checksum) break;
+        if (length & WAL_ERASE) {
+            dict.erase(key);
+        } else {
+            dict[key] = value;
+        }
+        pos += WAL_RECORD_HEADER + key_length;
+        stats.log_records++;
+    }
+    if (pos != log.size()) {
+        // Torn or corrupt tail from a crash in the middle of a commit
+        if (ftruncate(log_fd_, pos) != 0) {
+            throw io_error("Cannot truncate", log_path_);
+        }
+    }
+    log_bytes_ = pos;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats.seconds = elapsed.count();
+    return stats;
+}
+
+void Storage::append(std::string_view key, int value) {
+    append_record(key.size(), value, key);
+}
+
+void Storage::append_erase(std::string_view key) {
+    append_record(key.size() | WAL_ERASE, 0, key);
+}
+
+void Storage::append_record(uint32_t length, int32_t value, std::string_view key) {
+    uint32_t checksum = record_checksum(length, value, key);
+    buffer_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    buffer_.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    buffer_.append(key.data(), key.size());
+}
+
+void Storage::commit() {
+    if (buffer_.empty()) return;
+    write_all(log_fd_, buffer_.data(), buffer_.size(), log_path_);
+    if (fdatasync(log_fd_) != 0) {
+        throw io_error("Cannot sync", log_path_);
+    }
+    log_bytes_ += buffer_.size();
+    buffer_.clear();
+}
+
+void Storage::snapshot(const FlatDict& dict) {
+    std::string partial = snapshot_path_ + ".tmp";
+    int fd = open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw io_error("Cannot open", partial);
+    }
+
+    std::string out;
+    out.reserve(SNAPSHOT_CHUNK + sizeof(SnapshotEntry));
+    auto flush = [&](size_t threshold) {
+        if (out.size() >= threshold) {
+            write_all(fd, out.data(), out.size(), partial);
+            out.clear();
+        }
+    };
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.count = dict.size();
+    dict.for_each([&](std::string_view key, int) { header.key_bytes += key.size(); });
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Entries first, then the keys in the same order
+    uint64_t offset = 0;
+    dict.for_each([&](std::string_view key, int value) {
+        SnapshotEntry entry{offset, static_cast<uint32_t>(key.size()), value};
+        out.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        offset += key.size();
+        flush(SNAPSHOT_CHUNK);
+    });
+    dict.for_each([&](std::string_view key, int) {
+        out.append(key.data(), key.size());
+        flush(SNAPSHOT_CHUNK);
+    });
+    flush(0);
+
+    if (fsync(fd) != 0) {
+        close(fd);
+        throw io_error("Cannot sync", partial);
+    }
+    close(fd);
+    if (rename(partial.c_str(), snapshot_path_.c_str()) != 0) {
+        throw io_error("Cannot rename", partial);
+    }
+    // Make the rename durable before the log it replaces is dropped
+    int dir_fd = open(dir_.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    if (ftruncate(log_fd_, 0) != 0) {
+        throw io_error("Cannot truncate", log_path_);
+    }
+    log_bytes_ = 0;
+}
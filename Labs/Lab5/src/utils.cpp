@@ -1,14 +1,56 @@
 #include "utils.h"
 
-bool input_available() {
-    timeval tv{0, 0};
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(STDIN_FILENO, &fds);
-    select(STDIN_FILENO + 1, &fds, nullptr, nullptr, &tv);
-    return FD_ISSET(STDIN_FILENO, &fds);
-}
+#include <algorithm>
+#include <cerrno>
 
 std::chrono::system_clock::time_point now() {
     return std::chrono::system_clock::now();
 }
+
+bool LineReader::fill() {
+    char chunk[4096];
+    ssize_t n = read(fd_, chunk, sizeof(chunk));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return true;
+    }
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+    buffer_.append(chunk, n);
+    return true;
+}
+
+bool LineReader::has_line() const {
+    return buffer_.find('\n', start_) != std::string::npos || (eof_ && start_ < buffer_.size());
+}
+
+bool LineReader::next_line(std::string& line) {
+    size_t end = buffer_.find('\n', start_);
+    if (end == std::string::npos) {
+        if (!eof_ || start_ == buffer_.size()) {
+            return false;
+        }
+        end = buffer_.size();
+    }
+    line.assign(buffer_, start_, end - start_);
+    start_ = std::min(end + 1, buffer_.size());
+    // Consumed lines are dropped once they make up most of the buffer
+    if (start_ * 2 >= buffer_.size()) {
+        buffer_.erase(0, start_);
+        start_ = 0;
+    }
+    return true;
+}
+
+long poll_timeout(std::chrono::system_clock::time_point deadline) {
+    if (deadline == std::chrono::system_clock::time_point::max()) {
+        return -1;
+    }
+    auto left = deadline - now();
+    if (left <= std::chrono::system_clock::duration::zero()) {
+        return 0;
+    }
+    // Round up so the loop never wakes just before the deadline
+    return std::chrono::ceil<std::chrono::milliseconds>(left).count();
+}
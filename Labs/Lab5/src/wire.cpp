@@ -0,0 +1,179 @@
+#include "wire.h"
+
+static void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Small negative numbers such as -1 stay one byte
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static bool get_int(const uint8_t*& p, const uint8_t* end, int& value) {
+    uint64_t raw;
+    if (!get_varint(p, end, raw)) return false;
+    int64_t wide = unzigzag(raw);
+    if (wide < INT32_MIN || wide > INT32_MAX) return false;
+    value = static_cast<int>(wide);
+    return true;
+}
+
+static void put_string(std::string& out, const std::string& s) {
+    put_varint(out, s.size());
+    out += s;
+}
+
+static bool get_string(const uint8_t*& p, const uint8_t* end, std::string& s) {
+    uint64_t length;
+    if (!get_varint(p, end, length) || length > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    s.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+}
+
+std::string encode_message(const Message& msg) {
+    uint8_t flags = 0;
+    if (msg.add_data != -1) flags |= WIRE_HAS_ADD_DATA;
+    if (!msg.key.empty()) flags |= WIRE_HAS_KEY;
+    if (msg.request_id != 0) flags |= WIRE_HAS_REQUEST;
+    if (!msg.entries.empty()) flags |= WIRE_HAS_ENTRIES;
+    if (!msg.ranges.empty()) flags |= WIRE_HAS_RANGES;
+    if (msg.ring) flags |= WIRE_RING;
+    if (msg.interval != 0) flags |= WIRE_HAS_INTERVAL;
+
+    std::string out;
+    size_t size = WIRE_MAX_HEADER + 30 + msg.key.size() + msg.ranges.size() * 20;
+    for (const KeyValue& entry : msg.entries) {
+        size += entry.key.size() + 7;
+    }
+    out.reserve(size);
+    out += static_cast<char>(WIRE_VERSION);
+    out += static_cast<char>(msg.command);
+    out += static_cast<char>(flags);
+    put_varint(out, zigzag(msg.id));
+    if (flags & WIRE_HAS_ADD_DATA) {
+        put_varint(out, zigzag(msg.add_data));
+    }
+    if (flags & WIRE_HAS_KEY) {
+        put_string(out, msg.key);
+    }
+    if (flags & WIRE_HAS_REQUEST) {
+        put_varint(out, msg.request_id);
+    }
+    if (flags & WIRE_HAS_ENTRIES) {
+        put_varint(out, msg.entries.size());
+        for (const KeyValue& entry : msg.entries) {
+            put_string(out, entry.key);
+            out += static_cast<char>(entry.found);
+            if (entry.found) {
+                put_varint(out, zigzag(entry.value));
+            }
+        }
+    }
+    if (flags & WIRE_HAS_RANGES) {
+        put_varint(out, msg.ranges.size());
+        for (const KeyRange& range : msg.ranges) {
+            put_varint(out, range.from);
+            put_varint(out, range.to);
+        }
+    }
+    if (flags & WIRE_HAS_INTERVAL) {
+        put_varint(out, msg.interval);
+    }
+    return out;
+}
+
+static bool read_header(const uint8_t*& p, const uint8_t* end, WireHeader& header, uint8_t& flags) {
+    if (end - p < 3 || p[0] < WIRE_MIN_VERSION || p[0] > WIRE_VERSION) return false;
+    header.command = static_cast<CommandType>(p[1]);
+    flags = p[2];
+    if (flags & ~WIRE_KNOWN_FLAGS) return false;
+    p += 3;
+    return get_int(p, end, header.id);
+}
+
+bool decode_header(const void* data, size_t size, WireHeader& header) {
+    auto p = static_cast<const uint8_t*>(data);
+    uint8_t flags;
+    return read_header(p, p + size, header, flags);
+}
+
+bool decode_message(const void* data, size_t size, Message& msg) {
+    auto p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    WireHeader header;
+    uint8_t flags;
+    if (!read_header(p, end, header, flags)) return false;
+
+    msg.command = header.command;
+    msg.id = header.id;
+    msg.add_data = -1;
+    msg.key.clear();
+    msg.request_id = 0;
+    msg.entries.clear();
+    msg.ranges.clear();
+    msg.ring = (flags & WIRE_RING) != 0;
+    msg.interval = 0;
+    if ((flags & WIRE_HAS_ADD_DATA) && !get_int(p, end, msg.add_data)) {
+        return false;
+    }
+    if ((flags & WIRE_HAS_KEY) && !get_string(p, end, msg.key)) {
+        return false;
+    }
+    if ((flags & WIRE_HAS_REQUEST) && !get_varint(p, end, msg.request_id)) {
+        return false;
+    }
+    if (flags & WIRE_HAS_ENTRIES) {
+        uint64_t count;
+        // Every entry takes at least two bytes
+        if (!get_varint(p, end, count) || count > static_cast<uint64_t>(end - p) / 2) {
+            return false;
+        }
+        msg.entries.resize(count);
+        for (KeyValue& entry : msg.entries) {
+            if (!get_string(p, end, entry.key) || p == end) {
+                return false;
+            }
+            entry.found = *p++ != 0;
+            if (entry.found && !get_int(p, end, entry.value)) {
+                return false;
+            }
+        }
+    }
+    if (flags & WIRE_HAS_RANGES) {
+        uint64_t count;
+        if (!get_varint(p, end, count) || count > static_cast<uint64_t>(end - p) / 2) {
+            return false;
+        }
+        msg.ranges.resize(count);
+        for (KeyRange& range : msg.ranges) {
+            if (!get_varint(p, end, range.from) || !get_varint(p, end, range.to)) {
+                return false;
+            }
+        }
+    }
+    if ((flags & WIRE_HAS_INTERVAL) && !get_varint(p, end, msg.interval)) {
+        return false;
+    }
+    return p == end;
+}
@@ -0,0 +1,239 @@
+#include "worker.h"
+#include "hash_ring.h"
+#include "zmq_operations.h"
+
+#include <cstdlib>
+
+// Recovery reports its speed per this many keys once it has seen as many
+const size_t RATE_KEYS = 1000000;
+
+size_t worker_shard(std::string_view key, size_t count) {
+    return count == 1 ? 0 : HashRing::key_hash(key) % count;
+}
+
+static std::string pipe_address(int node_id, int index) {
+    return "inproc://node" + std::to_string(node_id) + "-worker" + std::to_string(index);
+}
+
+DictionaryWorker::DictionaryWorker(int node_id, int index, const char* data_dir, const std::string& storage_name)
+    : node_id_(node_id)
+    , index_(index)
+    , io_(bind_pipe(node_id, pipe_address(node_id, index)))
+    , worker_(connect_pipe(node_id, pipe_address(node_id, index)))
+{
+    if (data_dir) {
+        own_.storage = std::make_unique<Storage>(data_dir, storage_name);
+        ring_.storage = std::make_unique<Storage>(data_dir, storage_name + ".ring");
+    }
+    thread_ = std::thread(&DictionaryWorker::run, this);
+}
+
+DictionaryWorker::~DictionaryWorker() {
+    // Blocking send: the stop request must not be dropped by a full queue
+    zmq_lib::send_tagged(io_, 0, Message(CommandType::None, node_id_, -1), true);
+    thread_.join();
+}
+
+void DictionaryWorker::recover(Keyspace& keyspace, const char* name) {
+    if (!keyspace.storage) {
+        return;
+    }
+    FlatDict& dictionary = keyspace.dictionary;
+    RecoveryStats stats = keyspace.storage->recover(dictionary);
+    if (dictionary.size() > 0) {
+        std::cerr << "Node " << node_id_ << " worker " << index_ << " recovered " << dictionary.size()
+                  << " " << name << " keys (" << stats.snapshot_keys << " from snapshot, " << stats.log_records
+                  << " log records) in " << stats.seconds * 1e3 << " ms";
+        // A rate scaled up from a few keys says nothing
+        if (dictionary.size() >= RATE_KEYS) {
+            std::cerr << ", " << stats.seconds * 1e3 * RATE_KEYS / dictionary.size() << " ms per 1M keys";
+        }
+        std::cerr << std::endl;
+    }
+}
+
+size_t DictionaryWorker::pending_bytes() const {
+    size_t bytes = 0;
+    for (const Keyspace* keyspace : {&own_, &ring_}) {
+        if (keyspace->storage) {
+            bytes += keyspace->storage->pending_bytes();
+        }
+    }
+    return bytes;
+}
+
+void DictionaryWorker::run() {
+    try {
+        // Requests that arrive meanwhile wait in the pipe
+        recover(own_, "own");
+        recover(ring_, "ring");
+        zmq_pollitem_t item{worker_.socket, 0, ZMQ_POLLIN, 0};
+        while (true) {
+            if (zmq_poll(&item, 1, -1) < 0) {
+                if (zmq_errno() == EINTR) continue;
+                throw std::runtime_error("zmq_poll failed: " + std::string(zmq_strerror(zmq_errno())));
+            }
+            zmq_lib::Frame frame;
+            while (zmq_lib::receive_tagged(worker_, tag_, frame)) {
+                if (frame.header().command == CommandType::None) {
+                    flush();
+                    return;
+                }
+                // The I/O thread decoded it before, so this cannot fail
+                Message message;
+                if (frame.decode(message)) {
+                    handle(message);
+                }
+                if (replies_.size() >= WAL_GROUP_MAX || pending_bytes() >= WAL_GROUP_BYTES) {
+                    flush();
+                }
+            }
+            flush();
+        }
+    } catch (const std::exception& e) {
+        // Replies would stop coming; better to go down like a crashed node
+        std::cerr << "Error: node " << node_id_ << " worker " << index_ << ": " << e.what() << std::endl;
+        std::_Exit(1);
+    }
+}
+
+// One fsync for every write since the last flush, then all replies
+void DictionaryWorker::flush() {
+    if (replies_.empty()) {
+        return;
+    }
+    for (Keyspace* keyspace : {&own_, &ring_}) {
+        if (keyspace->storage) {
+            keyspace->storage->commit();
+        }
+    }
+    // Blocking: the I/O thread always drains the pipe, and a reply dropped
+    // at the queue limit would never be answered
+    for (const auto& [tag, reply] : replies_) {
+        zmq_lib::send_tagged(worker_, tag, reply, true);
+    }
+    replies_.clear();
+    for (Keyspace* keyspace : {&own_, &ring_}) {
+        if (keyspace->storage && keyspace->storage->wants_snapshot()) {
+            keyspace->storage->snapshot(keyspace->dictionary);
+        }
+    }
+}
+
+void DictionaryWorker::handle(const Message& message) {
+    switch (message.command) {
+    case CommandType::ExecAdd:
+        handle_exec_add(message);
+        break;
+    case CommandType::ExecFnd:
+        handle_exec_find(message);
+        break;
+    case CommandType::ExecMSet:
+        handle_exec_mset(message);
+        break;
+    case CommandType::ExecMGet:
+        handle_exec_mget(message);
+        break;
+    case CommandType::Scan:
+        handle_scan(message);
+        break;
+    case CommandType::Drop:
+        handle_drop(message);
+        break;
+    default: {
+        // Keep one reply per request
+        Message reply(CommandType::ExecErr, node_id_, -1, message.key);
+        reply.request_id = message.request_id;
+        answer(std::move(reply));
+        break;
+    }
+    }
+}
+
+// Answers the request being handled, under its tag
+void DictionaryWorker::answer(Message message) {
+    replies_.emplace_back(tag_, std::move(message));
+}
+
+// Logged when persistence is on; durable at the next flush()
+void DictionaryWorker::write(Keyspace& keyspace, std::string_view key, int value) {
+    keyspace.dictionary[key] = value;
+    if (keyspace.storage) {
+        keyspace.storage->append(key, value);
+    }
+}
+
+void DictionaryWorker::handle_exec_add(const Message& message) {
+    write(keyspace(message), message.key, message.add_data);
+    answer(message);
+}
+
+void DictionaryWorker::handle_exec_find(const Message& message) {
+    const int* value = keyspace(message).dictionary.find(message.key);
+    Message reply = value
+        ? Message(CommandType::ExecFnd, node_id_, *value, message.key)
+        : Message(CommandType::ExecErr, node_id_, -1, message.key);
+    reply.request_id = message.request_id;
+    answer(std::move(reply));
+}
+
+// Stores the whole batch and answers with the number of keys set
+void DictionaryWorker::handle_exec_mset(const Message& message) {
+    Keyspace& target = keyspace(message);
+    for (const KeyValue& entry : message.entries) {
+        write(target, entry.key, entry.value);
+    }
+    Message reply(CommandType::ExecMSet, node_id_, static_cast<int>(message.entries.size()));
+    reply.request_id = message.request_id;
+    answer(std::move(reply));
+}
+
+// Answers every key of the batch in one reply, in request order
+void DictionaryWorker::handle_exec_mget(const Message& message) {
+    Message reply(CommandType::ExecMGet, node_id_, static_cast<int>(message.entries.size()));
+    reply.request_id = message.request_id;
+    reply.entries.reserve(message.entries.size());
+    const FlatDict& dictionary = keyspace(message).dictionary;
+    for (const KeyValue& entry : message.entries) {
+        const int* value = dictionary.find(entry.key);
+        if (value) {
+            reply.entries.push_back({entry.key, *value, true});
+        } else {
+            reply.entries.push_back({entry.key, 0, false});
+        }
+    }
+    answer(std::move(reply));
+}
+
+// Copies out every ring key whose hash falls in the ranges, for a node
+// taking them over
+void DictionaryWorker::handle_scan(const Message& message) {
+    Message reply(CommandType::Scan, node_id_, -1);
+    reply.request_id = message.request_id;
+    ring_.dictionary.for_each([&](std::string_view key, int value) {
+        if (HashRing::contains(message.ranges, HashRing::key_hash(key))) {
+            reply.entries.push_back({std::string(key), value, true});
+        }
+    });
+    reply.add_data = static_cast<int>(reply.entries.size());
+    answer(std::move(reply));
+}
+
+// Erases the ring keys of the ranges once their new owner has them
+void DictionaryWorker::handle_drop(const Message& message) {
+    std::vector<std::string> keys;
+    ring_.dictionary.for_each([&](std::string_view key, int) {
+        if (HashRing::contains(message.ranges, HashRing::key_hash(key))) {
+            keys.emplace_back(key);
+        }
+    });
+    for (const std::string& key : keys) {
+        ring_.dictionary.erase(key);
+        if (ring_.storage) {
+            ring_.storage->append_erase(key);
+        }
+    }
+    Message reply(CommandType::Drop, node_id_, static_cast<int>(keys.size()));
+    reply.request_id = message.request_id;
+    answer(std::move(reply));
+}
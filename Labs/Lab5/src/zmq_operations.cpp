@@ -1,26 +1,118 @@
 #include "zmq_operations.h"
 
+#include <cstdlib>
+
 namespace zmq_lib {
+    static void send_bytes(void* socket, const std::string& bytes, int flags) {
+        zmq_send(socket, bytes.data(), bytes.size(), flags | ZMQ_DONTWAIT);
+    }
+
+    static bool receive_routing_id(Node& router, int& child_id) {
+        zmq_msg_t routing_id;
+        zmq_msg_init(&routing_id);
+
+        if (zmq_msg_recv(&routing_id, router.socket, ZMQ_DONTWAIT) == -1) {
+            zmq_msg_close(&routing_id);
+            return false;
+        }
+
+        child_id = std::atoi(std::string(static_cast<char*>(zmq_msg_data(&routing_id)),
+                                         zmq_msg_size(&routing_id)).c_str());
+        zmq_msg_close(&routing_id);
+        return true;
+    }
+
     void send_message(Node& node, const Message& msg) {
-        zmq_msg_t message;
-        zmq_msg_init_size(&message, sizeof(msg));
-        std::memcpy(zmq_msg_data(&message), &msg, sizeof(msg));
-        zmq_msg_send(&message, node.socket, ZMQ_DONTWAIT);
-        zmq_msg_close(&message);
+        send_bytes(node.socket, encode_message(msg), 0);
     }
 
     Message receive_message(Node& node) {
-        zmq_msg_t message;
-        zmq_msg_init(&message);
+        Frame frame;
+        Message msg;
+        while (receive_frame(node, frame)) {
+            if (frame.decode(msg)) {
+                return msg;
+            }
+        }
+        return Message(CommandType::None, -1, -1);
+    }
 
-        if (zmq_msg_recv(&message, node.socket, ZMQ_DONTWAIT) == -1) {
-            zmq_msg_close(&message);
-            return Message(CommandType::None, -1, -1);
+    void send_message(Node& router, const Child& child, const Message& msg) {
+        if (zmq_send(router.socket, child.routing_id.data(), child.routing_id.size(),
+                     ZMQ_SNDMORE | ZMQ_DONTWAIT) == -1) {
+            return;
         }
+        send_bytes(router.socket, encode_message(msg), 0);
+    }
 
+    Message receive_message(Node& router, int& child_id) {
+        Frame frame;
         Message msg;
-        std::memcpy(&msg, zmq_msg_data(&message), sizeof(Message));
-        zmq_msg_close(&message);
-        return msg;
+        while (receive_frame(router, frame, child_id)) {
+            if (frame.decode(msg)) {
+                return msg;
+            }
+        }
+        return Message(CommandType::None, -1, -1);
+    }
+
+    bool receive_frame(Node& node, Frame& frame) {
+        while (zmq_msg_recv(&frame.msg_, node.socket, ZMQ_DONTWAIT) != -1) {
+            if (decode_header(zmq_msg_data(&frame.msg_), zmq_msg_size(&frame.msg_), frame.header_)) {
+                return true;
+            }
+            std::cerr << "Dropping malformed message or unknown wire version" << std::endl;
+        }
+        return false;
+    }
+
+    bool receive_frame(Node& router, Frame& frame, int& child_id) {
+        // Multipart messages arrive whole, so the body follows its routing id
+        while (receive_routing_id(router, child_id)) {
+            if (zmq_msg_recv(&frame.msg_, router.socket, ZMQ_DONTWAIT) == -1) {
+                return false;
+            }
+            if (decode_header(zmq_msg_data(&frame.msg_), zmq_msg_size(&frame.msg_), frame.header_)) {
+                return true;
+            }
+            std::cerr << "Dropping malformed message or unknown wire version" << std::endl;
+        }
+        return false;
+    }
+
+    void forward(Node& node, Frame& frame) {
+        zmq_msg_send(&frame.msg_, node.socket, ZMQ_DONTWAIT);
+    }
+
+    bool send_tagged(Node& pipe, uint64_t tag, const Message& msg, bool block) {
+        int flags = block ? 0 : ZMQ_DONTWAIT;
+        // Parts of a multipart message are queued together or not at all
+        if (zmq_send(pipe.socket, &tag, sizeof(tag), ZMQ_SNDMORE | flags) == -1) {
+            return false;
+        }
+        std::string bytes = encode_message(msg);
+        zmq_send(pipe.socket, bytes.data(), bytes.size(), flags);
+        return true;
+    }
+
+    bool receive_tagged(Node& pipe, uint64_t& tag, Frame& frame) {
+        while (zmq_recv(pipe.socket, &tag, sizeof(tag), ZMQ_DONTWAIT) == sizeof(tag)) {
+            if (zmq_msg_recv(&frame.msg_, pipe.socket, ZMQ_DONTWAIT) == -1) {
+                return false;
+            }
+            if (decode_header(zmq_msg_data(&frame.msg_), zmq_msg_size(&frame.msg_), frame.header_)) {
+                return true;
+            }
+            std::cerr << "Dropping malformed message or unknown wire version" << std::endl;
+        }
+        return false;
+    }
+
+    void forward(Node& router, const Child& child, Frame& frame) {
+        if (zmq_send(router.socket, child.routing_id.data(), child.routing_id.size(),
+                     ZMQ_SNDMORE | ZMQ_DONTWAIT) == -1) {
+            return;
+        }
+        zmq_msg_send(&frame.msg_, router.socket, ZMQ_DONTWAIT);
     }
 }